@@ -11,8 +11,8 @@
 // Estrutura para representar uma peça do Tetris
 typedef struct
 {
-  char nome; // Tipo da peça ('I', 'O', 'T', 'L')
-  int id;    // Identificador único da peça
+  char nome;    // Tipo da peça ('I', 'O', 'T', 'L')
+  long long id; // Identificador único da peça (64 bits para não estourar)
 } Peca;
 
 // Estrutura para representar a fila de peças
@@ -25,7 +25,7 @@ typedef struct
 } FilaPecas;
 
 // Variável global para controlar o ID das peças
-int proximoId = 0;
+long long proximoId = 0;
 
 // Função para gerar uma peça aleatória
 Peca gerarPeca()
@@ -116,7 +116,7 @@ void exibirFila(FilaPecas *fila)
   int indice = fila->frente;
   for (int i = 0; i < fila->tamanho; i++)
   {
-    printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
+    printf("[%c %lld] ", fila->pecas[indice].nome, fila->pecas[indice].id);
     indice = (indice + 1) % TAMANHO_FILA;
   }
   printf("\n");
@@ -134,8 +134,10 @@ void exibirMenu()
 
 int main()
 {
-  // Configuração simplificada que funciona melhor no Windows
-  system("chcp 65001 > nul");
+  // Console em UTF-8 no Windows, sem abrir um processo do chcp
+#ifdef _WIN32
+  SetConsoleOutputCP(CP_UTF8);
+#endif
   setlocale(LC_ALL, "C.UTF-8");
 
   // Inicializa o gerador de números aleatórios
@@ -166,7 +168,7 @@ int main()
       Peca pecaJogada = jogarPeca(&fila);
       if (pecaJogada.id != -1)
       {
-        printf("Peça jogada: [%c %d]\n", pecaJogada.nome, pecaJogada.id);
+        printf("Peça jogada: [%c %lld]\n", pecaJogada.nome, pecaJogada.id);
       }
       break;
     }
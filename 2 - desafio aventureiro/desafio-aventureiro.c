@@ -12,8 +12,8 @@
 // Estrutura para representar uma peça do Tetris
 typedef struct
 {
-  char nome; // Tipo da peça ('I', 'O', 'T', 'L')
-  int id;    // Identificador único da peça
+  char nome;    // Tipo da peça ('I', 'O', 'T', 'L')
+  long long id; // Identificador único da peça (64 bits para não estourar)
 } Peca;
 
 // Estrutura para representar a fila de peças
@@ -33,7 +33,7 @@ typedef struct
 } PilhaReserva;
 
 // Variável global para controlar o ID das peças
-int proximoId = 0;
+long long proximoId = 0;
 
 // Função para gerar uma peça aleatória
 Peca gerarPeca()
@@ -185,7 +185,7 @@ int reservarPeca(FilaPecas *fila, PilhaReserva *pilha)
   // Adiciona nova peça à fila para manter o tamanho
   inserirPeca(fila);
 
-  printf("Peça [%c %d] foi reservada!\n", pecaReservada.nome, pecaReservada.id);
+  printf("Peça [%c %lld] foi reservada!\n", pecaReservada.nome, pecaReservada.id);
   return 1;
 }
 
@@ -195,7 +195,7 @@ int usarPecaReservada(PilhaReserva *pilha)
   Peca pecaUsada = desempilharPeca(pilha);
   if (pecaUsada.id != -1)
   {
-    printf("Peça reservada [%c %d] foi usada!\n", pecaUsada.nome, pecaUsada.id);
+    printf("Peça reservada [%c %lld] foi usada!\n", pecaUsada.nome, pecaUsada.id);
     return 1;
   }
   return 0;
@@ -215,7 +215,7 @@ void exibirFila(FilaPecas *fila)
     int indice = fila->frente;
     for (int i = 0; i < fila->tamanho; i++)
     {
-      printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
+      printf("[%c %lld] ", fila->pecas[indice].nome, fila->pecas[indice].id);
       indice = (indice + 1) % TAMANHO_FILA;
     }
   }
@@ -235,7 +235,7 @@ void exibirPilha(PilhaReserva *pilha)
   {
     for (int i = pilha->topo; i >= 0; i--)
     {
-      printf("[%c %d] ", pilha->pecas[i].nome, pilha->pecas[i].id);
+      printf("[%c %lld] ", pilha->pecas[i].nome, pilha->pecas[i].id);
     }
   }
   printf("\n");
@@ -263,8 +263,10 @@ void exibirMenu()
 
 int main()
 {
-  // Configuração simplificada que funciona melhor no Windows
-  system("chcp 65001 > nul");
+  // Console em UTF-8 no Windows, sem abrir um processo do chcp
+#ifdef _WIN32
+  SetConsoleOutputCP(CP_UTF8);
+#endif
   setlocale(LC_ALL, "C.UTF-8");
 
   // Inicializa o gerador de números aleatórios
@@ -297,7 +299,7 @@ int main()
       Peca pecaJogada = jogarPeca(&fila);
       if (pecaJogada.id != -1)
       {
-        printf("Peça jogada: [%c %d]\n", pecaJogada.nome, pecaJogada.id);
+        printf("Peça jogada: [%c %lld]\n", pecaJogada.nome, pecaJogada.id);
         // Adiciona nova peça à fila para manter o tamanho
         inserirPeca(&fila);
       }
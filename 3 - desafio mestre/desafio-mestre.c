@@ -1,57 +1,488 @@
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64    // Deslocamentos de 64 bits em arquivos maiores que 2 GiB
+#define _POSIX_C_SOURCE 200112L // fseeko
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
 #include <locale.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <threads.h>
+#include <sys/stat.h>
 #ifdef _WIN32
+#include <malloc.h>
 #include <windows.h>
 #endif
+#ifndef S_ISREG
+#define S_ISREG(modo) (((modo) & S_IFMT) == S_IFREG) // O MSVC não define S_ISREG
+#endif
 
 #define TAMANHO_FILA 5
 #define TAMANHO_PILHA 3
+#define TAMANHO_BLOCO 1024 // Peças por bloco da fila segmentada
+#define TIPOS_PECA 4
+#define TAMANHO_BLOCO_ID 65536 // IDs reservados de uma vez por thread
+#define LINHAS_TELA 16
+#define LINHA_ENTRADA_TELA 11 // Linha da tela onde o usuário digita a opção
+#define TAMANHO_LINHA_TELA 256 // Bytes por linha da tela (texto em UTF-8)
+#define JANELA_ESTATISTICAS 1000 // Peças por janela do teste qui-quadrado
+#define QUI_QUADRADO_CRITICO 7.815 // 3 graus de liberdade, 5% de significância
+#define JANELAS_GUARDADAS 16 // Janelas recentes com resumo guardado
+#define SECA_SUSPEITA 50 // Peças sem um tipo que tornam a seca suspeita ((3/4)^50 ≈ 5e-7)
+#define TAMANHO_FILA_LIXO 8
+#define MAX_JOGADORES 8
+#define ALTURA_MAXIMA 20 // Linhas de lixo que eliminam um jogador
+#define LIMITE_PASSOS_PARTIDA 10000
+#define ACOES_ARQUIVAVEIS 6 // Opções 0 a 5, três por byte (6 * 6 * 6 = 216)
+#define VERSAO_GRAVACAO 2 // Muda quando a mesma semente passa a gerar outras peças
+#define ACOES_GRAVAVEIS 8 // Opções 0 a 7 (8 e entradas inválidas não mudam o estado)
+#define TAMANHO_INDICE_ARQUIVO 44 // Bytes de cada entrada do índice do arquivo
+#define TAMANHO_LINHA_CACHE 64
+#define TAMANHO_TRECHO_CONSULTA 64 // Sessões por versão do resumo de um conjunto
+#define TAMANHO_PECA_REGISTRO 9
+#define TAMANHO_MAXIMO_REGISTRO (2 + 2 * TAMANHO_PECA_REGISTRO)
 
 // Estrutura para representar uma peça do Tetris
 typedef struct
 {
-  char nome; // Tipo da peça ('I', 'O', 'T', 'L')
-  int id;    // Identificador único da peça
+  char nome;    // Tipo da peça ('I', 'O', 'T', 'L')
+  long long id; // Identificador único da peça (64 bits para não estourar)
 } Peca;
 
 // Estrutura para representar a fila de peças
+// Os índices vêm antes das peças para ficarem juntos no início da linha de cache
 typedef struct
 {
-  Peca pecas[TAMANHO_FILA];
   int frente;  // Índice do primeiro elemento
   int tras;    // Índice após o último elemento
   int tamanho; // Número atual de elementos na fila
+  unsigned int gerador; // Estado do gerador das peças desta fila
+  Peca pecas[TAMANHO_FILA];
 } FilaPecas;
 
 // Estrutura para representar a pilha de reserva
 typedef struct
 {
-  Peca pecas[TAMANHO_PILHA];
   int topo; // Índice do topo da pilha (-1 para pilha vazia)
+  Peca pecas[TAMANHO_PILHA];
 } PilhaReserva;
 
-// Variável global para controlar o ID das peças
-int proximoId = 0;
+// Estrutura para representar um bloco de peças da fila segmentada
+typedef struct BlocoPecas
+{
+  Peca pecas[TAMANHO_BLOCO];
+  struct BlocoPecas *proximo; // Próximo bloco da fila (ou da lista de livres)
+} BlocoPecas;
+
+// Estrutura para representar uma fila sem limite de tamanho (modo de análise)
+typedef struct
+{
+  BlocoPecas *blocoFrente;  // Bloco que contém o primeiro elemento
+  BlocoPecas *blocoTras;    // Bloco que recebe o próximo elemento
+  BlocoPecas *blocosLivres; // Blocos já esvaziados, reaproveitados antes de alocar novos
+  int frente;               // Índice do primeiro elemento dentro de blocoFrente
+  int tras;                 // Índice após o último elemento dentro de blocoTras
+  long long tamanho;        // Número atual de elementos na fila
+  int blocosAlocados;       // Blocos pedidos ao malloc até agora
+  unsigned int gerador;     // Estado do gerador das peças desta fila
+} FilaSegmentada;
+
+// Estrutura para registrar uma ação de forma reversível (apenas o que muda)
+// No histórico ela fica compactada: só os campos usados pela ação são gravados
+typedef struct
+{
+  char acao;     // Opção do menu que gerou a ação (1 a 5)
+  Peca removida; // Peça retirada da fila (ações 1 e 2) ou da pilha (ação 3)
+  Peca gerada;   // Peça gerada no final da fila (ações 1 e 2)
+} RegistroAcao;
+
+// Estrutura para representar o histórico de ações (desfazer/refazer)
+// Cada registro ocupa de 2 a 20 bytes, com o código da ação no início e no fim
+// para que o histórico possa ser percorrido nos dois sentidos
+typedef struct
+{
+  unsigned char *dados;
+  size_t capacidade; // Bytes alocados
+  size_t total;      // Bytes válidos, incluindo os registros que podem ser refeitos
+  size_t atual;      // Bytes dos registros atualmente aplicados ao estado do jogo
+} Historico;
+
+struct PoolSessoes;
+
+// Estrutura com os campos quentes de uma sessão, copiados da fila e da pilha
+// Os índices cabem em um byte (fila de 5 e pilha de 3 posições)
+typedef struct
+{
+  signed char frente;  // fila.frente
+  signed char tras;    // fila.tras
+  signed char tamanho; // fila.tamanho
+  signed char topo;    // pilha.topo
+  char tipoFrente;     // Tipo da peça da frente da fila (' ' se vazia)
+} CabecalhoSessao;
+
+// Estrutura para representar uma sessão de jogo independente
+// Cada sessão guarda todo o seu estado, então várias podem ser conduzidas
+// pela mesma thread, uma ação por vez, conforme as entradas chegam.
+// Cada sessão começa em uma linha de cache própria, então sessões de threads
+// diferentes nunca dividem uma linha (sem falso compartilhamento).
+// O cabeçalho quente fica nos primeiros 16 bytes, junto com ativa e emUso, e é
+// atualizado ao fim de cada ação; as consultas não leem a sessão: o resumo dela
+// é publicado, a partir do cabeçalho, nos vetores do conjunto a que pertence
+typedef struct
+{
+  _Alignas(TAMANHO_LINHA_CACHE) struct PoolSessoes *pool; // Conjunto da sessão (NULL se avulsa)
+  CabecalhoSessao cabecalho;
+  signed char ativa; // 1 enquanto a sessão aguarda entradas, 0 após sair
+  signed char emUso; // 1 enquanto a sessão pertence a alguém (só o conjunto muda)
+  FilaPecas fila;
+  PilhaReserva pilha;
+  Historico historico;
+} Sessao;
+
+// Estrutura para representar um conjunto de sessões de uma thread de trabalho
+// Fica em uma linha de cache própria, separada dos conjuntos das outras threads.
+// O resumo das sessões fica em vetores compactos (um byte por sessão), protegidos
+// por uma versão a cada TAMANHO_TRECHO_CONSULTA sessões; só a thread dona escreve.
+// Os bytes do resumo são atômicos porque a consulta os lê enquanto a dona escreve
+// (sem isso seria uma disputa de dados); os acessos são relaxados, e em x86 e ARM
+// viram leituras e escritas comuns de um byte. A versão garante a coerência do trecho
+typedef struct PoolSessoes
+{
+  _Alignas(TAMANHO_LINHA_CACHE) Sessao *sessoes; // Vetor alinhado à linha de cache
+  int capacidade;   // Quantidade de sessões do vetor
+  int proximaLivre; // Onde começar a procurar a próxima sessão livre
+  int emUso;        // Sessões entregues e ainda não devolvidas
+  int trechos;      // Quantidade de versões (trechos de sessões)
+  _Atomic signed char *ativas;       // Resumo: sessão ativa (0 ou 1)
+  _Atomic signed char *tamanhosFila; // Resumo: peças na fila
+  _Atomic signed char *topos;        // Resumo: topo da pilha de reserva
+  _Atomic char *frentes;             // Resumo: tipo da peça da frente
+  _Atomic unsigned int *versoes; // Ímpar enquanto o trecho é alterado
+} PoolSessoes;
+
+// Estrutura com o resultado de uma consulta sobre todas as sessões
+typedef struct
+{
+  long long sessoesAtivas;
+  long long pilhasCheias;
+  long long trocaMultiplaPossivel;
+  long long frentePorTipo[TIPOS_PECA]; // Na ordem 'I', 'O', 'T', 'L'
+} ConsultaSessoes;
+
+// Estrutura para representar a fila de ataques (linhas de lixo) recebidos
+// Mesmo desenho circular da FilaPecas
+typedef struct
+{
+  int linhas[TAMANHO_FILA_LIXO]; // Linhas de lixo de cada ataque pendente
+  int frente;                    // Índice do primeiro elemento
+  int tras;                      // Índice após o último elemento
+  int tamanho;                   // Número atual de elementos na fila
+} FilaLixo;
+
+// Estrutura para representar um jogador de uma partida versus
+typedef struct
+{
+  Sessao sessao;
+  FilaLixo lixo;
+  unsigned int geradorAcoes; // Gerador que sorteia as ações deste jogador
+  int altura; // Linhas de lixo já recebidas no campo
+  int vivo;   // 0 depois de eliminado
+} Jogador;
+
+// Estrutura para representar uma partida versus entre vários jogadores
+typedef struct
+{
+  Jogador jogadores[MAX_JOGADORES];
+  int quantidade; // Jogadores na partida
+  int vivos;      // Jogadores ainda não eliminados
+  int passo;      // Rodadas já simuladas
+} Partida;
+
+// Estrutura para representar uma entrada do índice de um arquivo de partidas
+typedef struct
+{
+  unsigned int sessao;  // Identificador da sessão gravada
+  unsigned int semente; // Semente do gerador de peças
+  long long inicio;     // Data de início da partida
+  long long fim;        // Data da última modificação da gravação
+  int acoes;            // Total de opções da partida
+  int extras;           // Opções 6 e 7, guardadas fora da sequência compactada
+  int bytesExtras;      // Bytes da lista de opções extras
+  unsigned long long deslocamento; // Onde começam os dados da partida
+} EntradaArquivo;
+
+// Estrutura para guardar o resumo de uma janela do teste qui-quadrado
+typedef struct
+{
+  int contagem[TIPOS_PECA]; // Peças de cada tipo na janela
+  double quiQuadrado;       // Resultado do teste da janela
+} ResumoJanela;
+
+// Estrutura para acompanhar a distribuição das peças geradas
+typedef struct
+{
+  long long total;                        // Peças geradas desde o início
+  long long contagem[TIPOS_PECA];         // Peças geradas de cada tipo
+  long long ultimaPosicao[TIPOS_PECA];    // Posição da última peça de cada tipo (-1 se nunca saiu)
+  long long maiorSeca[TIPOS_PECA];        // Maior intervalo sem sair cada tipo
+  int contagemJanela[TIPOS_PECA];         // Peças de cada tipo na janela atual
+  int pecasJanela;                        // Peças já contadas na janela atual
+  double ultimoQuiQuadrado;               // Resultado do teste da última janela completa
+  int janelasReprovadas;                  // Janelas acima do valor crítico
+  int janelasCompletas;                   // Janelas já avaliadas
+  int ultimoTipo;                         // Tipo da peça anterior (-1 no início)
+  int sequenciaAtual;                     // Repetições seguidas do último tipo
+  int maiorSequencia;                     // Maior número de repetições seguidas
+  int secasSuspeitas;                     // Secas que chegaram a SECA_SUSPEITA peças
+  ResumoJanela janelas[JANELAS_GUARDADAS]; // Últimas janelas completas (circular, pela ordem de janelasCompletas)
+} EstatisticasPecas;
+
+// Contador compartilhado com o início do próximo bloco de IDs ainda livre
+_Atomic long long proximoBlocoId = 0;
+
+// Bloco de IDs reservado pela thread atual (próximo ID e limite do bloco)
+// Cada thread só acessa o contador compartilhado uma vez a cada TAMANHO_BLOCO_ID peças
+_Thread_local long long proximoId = 0;
+_Thread_local long long limiteId = 0;
+
+// Estrutura para representar a tela do modo terminal (--tui)
+// Guarda o quadro anterior para enviar ao terminal apenas o que mudou
+typedef struct
+{
+  char atual[LINHAS_TELA][TAMANHO_LINHA_TELA];    // Quadro sendo montado
+  char anterior[LINHAS_TELA][TAMANHO_LINHA_TELA]; // Último quadro enviado ao terminal
+  int primeiroQuadro;                             // 1 até o primeiro quadro ser enviado
+} Tela;
+
+// Estatísticas das peças geradas pela thread atual (cada thread tem as suas, sem disputa)
+_Thread_local EstatisticasPecas estatisticas = {0, {0}, {-1, -1, -1, -1}, {0}, {0}, 0, 0, 0, 0, -1, 0, 0, 0, {{{0}, 0}}};
+
+// Variável global que desativa as mensagens de ação/erro (modo de repetição)
+int exibirMensagens = 1;
+
+// Variáveis globais do modo terminal: as mensagens vão para a linha de status
+int modoTela = 0;
+char mensagemTela[TAMANHO_LINHA_TELA] = "";
+
+// Função para exibir uma mensagem de ação ou de erro
+void exibirMensagem(const char *formato, ...)
+{
+  if (!exibirMensagens)
+  {
+    return;
+  }
+
+  va_list argumentos;
+  va_start(argumentos, formato);
+  if (modoTela)
+  {
+    // Guarda só a última mensagem, sem a quebra de linha final
+    vsnprintf(mensagemTela, sizeof(mensagemTela), formato, argumentos);
+    mensagemTela[strcspn(mensagemTela, "\n")] = '\0';
+  }
+  else
+  {
+    vprintf(formato, argumentos);
+  }
+  va_end(argumentos);
+}
+
+// Função para transformar uma semente no estado inicial de um gerador
+// O gerador (xorshift) é igual em qualquer plataforma, então uma partida gravada
+// com a mesma semente é repetida exatamente.
+// A semente passa pelo embaralhamento final do murmur3 (fmix32): sem ele, sementes
+// vizinhas (partidas iniciadas com segundos de diferença, ou semente + i) geram
+// sequências de peças parecidas
+unsigned int prepararSemente(unsigned int semente)
+{
+  semente ^= semente >> 16;
+  semente *= 0x85EBCA6Bu;
+  semente ^= semente >> 13;
+  semente *= 0xC2B2AE35u;
+  semente ^= semente >> 16;
+
+  // O xorshift não pode partir do zero
+  return semente != 0 ? semente : 1;
+}
+
+// Função para sortear o próximo número aleatório de um gerador
+// Cada fila (e cada simulação) tem o seu gerador, então threads diferentes não disputam estado
+unsigned int numeroAleatorio(unsigned int *estado)
+{
+  *estado ^= *estado << 13;
+  *estado ^= *estado >> 17;
+  *estado ^= *estado << 5;
+  return *estado;
+}
+
+// Função para obter um novo ID de peça, único entre todas as threads
+long long novoId()
+{
+  if (proximoId == limiteId)
+  {
+    proximoId = atomic_fetch_add(&proximoBlocoId, TAMANHO_BLOCO_ID);
+    limiteId = proximoId + TAMANHO_BLOCO_ID;
+  }
+  return proximoId++;
+}
+
+// Função para reiniciar a numeração das peças (usada nos modos de repetição e teste)
+void reiniciarIds()
+{
+  atomic_store(&proximoBlocoId, 0);
+  proximoId = 0;
+  limiteId = 0;
+}
+
+// Função para zerar as estatísticas
+void reiniciarEstatisticas(EstatisticasPecas *estatisticas)
+{
+  memset(estatisticas, 0, sizeof(EstatisticasPecas));
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    estatisticas->ultimaPosicao[i] = -1;
+  }
+  estatisticas->ultimoTipo = -1;
+}
+
+// Função para guardar o resumo de uma janela completa e contá-la
+// Só as últimas JANELAS_GUARDADAS ficam guardadas (sem alocação)
+void guardarJanela(EstatisticasPecas *estatisticas, const ResumoJanela *janela)
+{
+  estatisticas->janelas[estatisticas->janelasCompletas % JANELAS_GUARDADAS] = *janela;
+  estatisticas->ultimoQuiQuadrado = janela->quiQuadrado;
+  estatisticas->janelasCompletas++;
+}
+
+// Função para calcular o qui-quadrado da janela atual e começar uma nova
+void fecharJanelaEstatisticas(EstatisticasPecas *estatisticas)
+{
+  double esperado = (double)estatisticas->pecasJanela / TIPOS_PECA;
+  ResumoJanela janela;
+  janela.quiQuadrado = 0;
+
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    double diferenca = estatisticas->contagemJanela[i] - esperado;
+    janela.quiQuadrado += diferenca * diferenca / esperado;
+    janela.contagem[i] = estatisticas->contagemJanela[i];
+    estatisticas->contagemJanela[i] = 0;
+  }
+
+  guardarJanela(estatisticas, &janela);
+  if (janela.quiQuadrado > QUI_QUADRADO_CRITICO)
+  {
+    estatisticas->janelasReprovadas++;
+  }
+  estatisticas->pecasJanela = 0;
+}
+
+// Função para juntar as estatísticas de outra thread/sessão ao total (a origem vem depois do destino)
+// As secas e sequências que atravessam a junção não são emendadas, e a janela incompleta da origem é descartada
+void mesclarEstatisticas(EstatisticasPecas *destino, const EstatisticasPecas *origem)
+{
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    // A seca em andamento da origem também conta, pois ela termina na junção
+    long long secaFinal = origem->total - origem->ultimaPosicao[i] - 1;
+    long long seca = origem->maiorSeca[i] > secaFinal ? origem->maiorSeca[i] : secaFinal;
+    if (seca > destino->maiorSeca[i])
+    {
+      destino->maiorSeca[i] = seca;
+    }
+    if (origem->ultimaPosicao[i] >= 0)
+    {
+      destino->ultimaPosicao[i] = destino->total + origem->ultimaPosicao[i];
+    }
+    destino->contagem[i] += origem->contagem[i];
+  }
+  destino->total += origem->total;
+
+  if (origem->maiorSequencia > destino->maiorSequencia)
+  {
+    destino->maiorSequencia = origem->maiorSequencia;
+  }
+  destino->ultimoTipo = origem->ultimoTipo;
+  destino->sequenciaAtual = origem->sequenciaAtual;
+
+  // As janelas da origem entram depois das do destino; as guardadas vão em ordem
+  int guardadas = origem->janelasCompletas < JANELAS_GUARDADAS ? origem->janelasCompletas : JANELAS_GUARDADAS;
+  destino->janelasCompletas += origem->janelasCompletas - guardadas;
+  for (int i = origem->janelasCompletas - guardadas; i < origem->janelasCompletas; i++)
+  {
+    guardarJanela(destino, &origem->janelas[i % JANELAS_GUARDADAS]);
+  }
+  destino->janelasReprovadas += origem->janelasReprovadas;
+  destino->secasSuspeitas += origem->secasSuspeitas;
+}
+
+// Função para registrar uma peça gerada nas estatísticas (custo constante, sem alocação)
+void registrarEstatistica(EstatisticasPecas *estatisticas, int tipo)
+{
+  long long posicao = estatisticas->total++;
+
+  // Seca suspeita: conta uma vez, quando um dos outros tipos completa SECA_SUSPEITA peças sumido
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    estatisticas->secasSuspeitas += i != tipo && posicao - estatisticas->ultimaPosicao[i] == SECA_SUSPEITA;
+  }
+
+  // Seca: quantas peças saíram desde a última peça deste tipo
+  long long seca = posicao - estatisticas->ultimaPosicao[tipo] - 1;
+  if (seca > estatisticas->maiorSeca[tipo])
+  {
+    estatisticas->maiorSeca[tipo] = seca;
+  }
+  estatisticas->ultimaPosicao[tipo] = posicao;
+  estatisticas->contagem[tipo]++;
+
+  // Sequência de peças repetidas
+  if (tipo == estatisticas->ultimoTipo)
+  {
+    estatisticas->sequenciaAtual++;
+  }
+  else
+  {
+    estatisticas->ultimoTipo = tipo;
+    estatisticas->sequenciaAtual = 1;
+  }
+  if (estatisticas->sequenciaAtual > estatisticas->maiorSequencia)
+  {
+    estatisticas->maiorSequencia = estatisticas->sequenciaAtual;
+  }
+
+  // Janela do teste qui-quadrado
+  estatisticas->contagemJanela[tipo]++;
+  estatisticas->pecasJanela++;
+  if (estatisticas->pecasJanela == JANELA_ESTATISTICAS)
+  {
+    fecharJanelaEstatisticas(estatisticas);
+  }
+}
 
 // Função para gerar uma peça aleatória
-Peca gerarPeca()
+Peca gerarPeca(unsigned int *gerador)
 {
   char tipos[] = {'I', 'O', 'T', 'L'};
   Peca novaPeca;
 
   // Gera um tipo aleatório
-  novaPeca.nome = tipos[rand() % 4];
+  int tipo = numeroAleatorio(gerador) % TIPOS_PECA;
+  novaPeca.nome = tipos[tipo];
+  registrarEstatistica(&estatisticas, tipo);
   // Atribui o próximo ID disponível
-  novaPeca.id = proximoId++;
+  novaPeca.id = novoId();
 
   return novaPeca;
 }
 
-// Função para inicializar a fila
-void inicializarFila(FilaPecas *fila)
+// Função para inicializar a fila (a semente define a sequência de peças)
+void inicializarFila(FilaPecas *fila, unsigned int semente)
 {
+  fila->gerador = prepararSemente(semente);
   fila->frente = 0;
   fila->tras = 0;
   fila->tamanho = 0;
@@ -59,7 +490,7 @@ void inicializarFila(FilaPecas *fila)
   // Preenche a fila com 5 peças iniciais
   for (int i = 0; i < TAMANHO_FILA; i++)
   {
-    fila->pecas[fila->tras] = gerarPeca();
+    fila->pecas[fila->tras] = gerarPeca(&fila->gerador);
     fila->tras = (fila->tras + 1) % TAMANHO_FILA;
     fila->tamanho++;
   }
@@ -100,7 +531,7 @@ Peca jogarPeca(FilaPecas *fila)
 {
   if (filaVazia(fila))
   {
-    printf("Erro: A fila está vazia!\n");
+    exibirMensagem("Erro: A fila está vazia!\n");
     Peca pecaVazia = {' ', -1};
     return pecaVazia;
   }
@@ -117,23 +548,145 @@ int inserirPeca(FilaPecas *fila)
 {
   if (filaCheia(fila))
   {
-    printf("Erro: A fila está cheia!\n");
+    exibirMensagem("Erro: A fila está cheia!\n");
     return 0;
   }
 
-  fila->pecas[fila->tras] = gerarPeca();
+  fila->pecas[fila->tras] = gerarPeca(&fila->gerador);
   fila->tras = (fila->tras + 1) % TAMANHO_FILA;
   fila->tamanho++;
 
   return 1;
 }
 
+// Função para obter um bloco vazio (reaproveita blocos liberados antes de alocar)
+BlocoPecas *obterBloco(FilaSegmentada *fila)
+{
+  BlocoPecas *bloco = fila->blocosLivres;
+
+  if (bloco != NULL)
+  {
+    fila->blocosLivres = bloco->proximo;
+  }
+  else
+  {
+    bloco = malloc(sizeof(BlocoPecas));
+    if (bloco == NULL)
+    {
+      return NULL;
+    }
+    fila->blocosAlocados++;
+  }
+
+  bloco->proximo = NULL;
+  return bloco;
+}
+
+// Função para inicializar a fila segmentada (começa vazia, sem blocos)
+void inicializarFilaSegmentada(FilaSegmentada *fila, unsigned int semente)
+{
+  fila->gerador = prepararSemente(semente);
+  fila->blocoFrente = NULL;
+  fila->blocoTras = NULL;
+  fila->blocosLivres = NULL;
+  fila->frente = 0;
+  fila->tras = 0;
+  fila->tamanho = 0;
+  fila->blocosAlocados = 0;
+}
+
+// Função para inserir uma nova peça no final da fila segmentada
+int inserirPecaSegmentada(FilaSegmentada *fila)
+{
+  // Abre um novo bloco quando a fila está vazia ou o último bloco está cheio
+  if (fila->blocoTras == NULL || fila->tras == TAMANHO_BLOCO)
+  {
+    BlocoPecas *novoBloco = obterBloco(fila);
+    if (novoBloco == NULL)
+    {
+      exibirMensagem("Erro: Memória insuficiente para a fila segmentada!\n");
+      return 0;
+    }
+
+    if (fila->blocoTras == NULL)
+    {
+      fila->blocoFrente = novoBloco;
+      fila->frente = 0;
+    }
+    else
+    {
+      fila->blocoTras->proximo = novoBloco;
+    }
+    fila->blocoTras = novoBloco;
+    fila->tras = 0;
+  }
+
+  fila->blocoTras->pecas[fila->tras] = gerarPeca(&fila->gerador);
+  fila->tras++;
+  fila->tamanho++;
+
+  return 1;
+}
+
+// Função para remover uma peça da frente da fila segmentada
+Peca jogarPecaSegmentada(FilaSegmentada *fila)
+{
+  if (fila->tamanho == 0)
+  {
+    exibirMensagem("Erro: A fila segmentada está vazia!\n");
+    Peca pecaVazia = {' ', -1};
+    return pecaVazia;
+  }
+
+  Peca pecaJogada = fila->blocoFrente->pecas[fila->frente];
+  fila->frente++;
+  fila->tamanho--;
+
+  // Devolve o bloco esgotado para a lista de blocos livres
+  if (fila->tamanho == 0 || fila->frente == TAMANHO_BLOCO)
+  {
+    BlocoPecas *blocoEsgotado = fila->blocoFrente;
+    fila->blocoFrente = blocoEsgotado->proximo;
+    fila->frente = 0;
+
+    blocoEsgotado->proximo = fila->blocosLivres;
+    fila->blocosLivres = blocoEsgotado;
+
+    if (fila->blocoFrente == NULL)
+    {
+      fila->blocoTras = NULL;
+      fila->tras = 0;
+    }
+  }
+
+  return pecaJogada;
+}
+
+// Função para liberar todos os blocos da fila segmentada
+void liberarFilaSegmentada(FilaSegmentada *fila)
+{
+  BlocoPecas *listas[2] = {fila->blocoFrente, fila->blocosLivres};
+
+  for (int i = 0; i < 2; i++)
+  {
+    BlocoPecas *bloco = listas[i];
+    while (bloco != NULL)
+    {
+      BlocoPecas *proximo = bloco->proximo;
+      free(bloco);
+      bloco = proximo;
+    }
+  }
+
+  inicializarFilaSegmentada(fila, fila->gerador);
+}
+
 // Função para empilhar uma peça na pilha de reserva (push)
 int empilharPeca(PilhaReserva *pilha, Peca peca)
 {
   if (pilhaCheia(pilha))
   {
-    printf("Erro: A pilha de reserva está cheia!\n");
+    exibirMensagem("Erro: A pilha de reserva está cheia!\n");
     return 0;
   }
 
@@ -147,7 +700,7 @@ Peca desempilharPeca(PilhaReserva *pilha)
 {
   if (pilhaVazia(pilha))
   {
-    printf("Erro: A pilha de reserva está vazia!\n");
+    exibirMensagem("Erro: A pilha de reserva está vazia!\n");
     Peca pecaVazia = {' ', -1};
     return pecaVazia;
   }
@@ -162,13 +715,13 @@ int reservarPeca(FilaPecas *fila, PilhaReserva *pilha)
 {
   if (filaVazia(fila))
   {
-    printf("Erro: Não há peças na fila para reservar!\n");
+    exibirMensagem("Erro: Não há peças na fila para reservar!\n");
     return 0;
   }
 
   if (pilhaCheia(pilha))
   {
-    printf("Erro: A pilha de reserva está cheia!\n");
+    exibirMensagem("Erro: A pilha de reserva está cheia!\n");
     return 0;
   }
 
@@ -185,7 +738,7 @@ int reservarPeca(FilaPecas *fila, PilhaReserva *pilha)
   // Adiciona nova peça à fila para manter o tamanho
   inserirPeca(fila);
 
-  printf("Ação: peça [%c %d] enviada para a pilha de reserva!\n", pecaReservada.nome, pecaReservada.id);
+  exibirMensagem("Ação: peça [%c %lld] enviada para a pilha de reserva!\n", pecaReservada.nome, pecaReservada.id);
   return 1;
 }
 
@@ -195,122 +748,356 @@ int usarPecaReservada(PilhaReserva *pilha)
   Peca pecaUsada = desempilharPeca(pilha);
   if (pecaUsada.id != -1)
   {
-    printf("Ação: peça reservada [%c %d] foi usada!\n", pecaUsada.nome, pecaUsada.id);
+    exibirMensagem("Ação: peça reservada [%c %lld] foi usada!\n", pecaUsada.nome, pecaUsada.id);
     return 1;
   }
   return 0;
 }
 
+// Função para realizar a troca entre a frente da fila e o topo da pilha (sem validação)
+void aplicarTrocaAtual(FilaPecas *fila, PilhaReserva *pilha)
+{
+  // Salva a peça da frente da fila
+  Peca pecaFila = fila->pecas[fila->frente];
+
+  // Realiza a troca
+  fila->pecas[fila->frente] = pilha->pecas[pilha->topo];
+  pilha->pecas[pilha->topo] = pecaFila;
+}
+
 // Função para trocar a peça da frente da fila com o topo da pilha
 int trocarPecaAtual(FilaPecas *fila, PilhaReserva *pilha)
 {
   if (filaVazia(fila))
   {
-    printf("Erro: A fila está vazia!\n");
+    exibirMensagem("Erro: A fila está vazia!\n");
     return 0;
   }
 
   if (pilhaVazia(pilha))
   {
-    printf("Erro: A pilha de reserva está vazia!\n");
+    exibirMensagem("Erro: A pilha de reserva está vazia!\n");
     return 0;
   }
 
-  // Salva a peça da frente da fila
+  // Salva as peças envolvidas para a mensagem
   Peca pecaFila = fila->pecas[fila->frente];
-
-  // Salva a peça do topo da pilha
   Peca pecaPilha = pilha->pecas[pilha->topo];
 
-  // Realiza a troca
-  fila->pecas[fila->frente] = pecaPilha;
-  pilha->pecas[pilha->topo] = pecaFila;
+  aplicarTrocaAtual(fila, pilha);
 
-  printf("Ação: troca realizada entre a peça da frente da fila [%c %d] e o topo da pilha [%c %d]!\n",
+  exibirMensagem("Ação: troca realizada entre a peça da frente da fila [%c %lld] e o topo da pilha [%c %lld]!\n",
          pecaFila.nome, pecaFila.id, pecaPilha.nome, pecaPilha.id);
   return 1;
 }
 
-// Função para trocar múltiplas peças (3 da fila com 3 da pilha)
-int trocaMultipla(FilaPecas *fila, PilhaReserva *pilha)
+// Função para realizar a troca múltipla (sem validação)
+// A troca é sua própria inversa: aplicá-la duas vezes restaura o estado original
+void aplicarTrocaMultipla(FilaPecas *fila, PilhaReserva *pilha)
 {
-  // Verifica se a fila tem pelo menos 3 peças
-  if (fila->tamanho < 3)
-  {
-    printf("Erro: A fila deve ter pelo menos 3 peças para a troca múltipla!\n");
-    return 0;
-  }
-
-  // Verifica se a pilha tem exatamente 3 peças
-  if (pilha->topo != 2)
-  {
-    printf("Erro: A pilha deve ter exatamente 3 peças para a troca múltipla!\n");
-    return 0;
-  }
-
   // Arrays temporários para armazenar as peças
-  Peca pecasFila[3];
-  Peca pecasPilha[3];
+  Peca pecasFila[TAMANHO_PILHA];
+  Peca pecasPilha[TAMANHO_PILHA];
 
   // Salva as 3 primeiras peças da fila
   int indiceFila = fila->frente;
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < TAMANHO_PILHA; i++)
   {
     pecasFila[i] = fila->pecas[indiceFila];
     indiceFila = (indiceFila + 1) % TAMANHO_FILA;
   }
 
   // Salva as 3 peças da pilha (do topo para a base)
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < TAMANHO_PILHA; i++)
   {
-    pecasPilha[i] = pilha->pecas[2 - i]; // Inverte a ordem para manter a lógica LIFO
+    pecasPilha[i] = pilha->pecas[TAMANHO_PILHA - 1 - i]; // Inverte a ordem para manter a lógica LIFO
   }
 
   // Coloca as peças da pilha na fila (nas 3 primeiras posições)
   indiceFila = fila->frente;
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < TAMANHO_PILHA; i++)
   {
     fila->pecas[indiceFila] = pecasPilha[i];
     indiceFila = (indiceFila + 1) % TAMANHO_FILA;
   }
 
   // Coloca as peças da fila na pilha (invertendo a ordem para manter LIFO)
-  for (int i = 0; i < 3; i++)
+  for (int i = 0; i < TAMANHO_PILHA; i++)
   {
-    pilha->pecas[i] = pecasFila[2 - i];
+    pilha->pecas[i] = pecasFila[TAMANHO_PILHA - 1 - i];
   }
-
-  printf("Ação: troca realizada entre os 3 primeiros da fila e os 3 da pilha!\n");
-  return 1;
 }
 
-// Função para exibir o estado atual da fila
-void exibirFila(FilaPecas *fila)
+// Função para trocar múltiplas peças (3 da fila com 3 da pilha)
+int trocaMultipla(FilaPecas *fila, PilhaReserva *pilha)
 {
-  printf("Fila de peças\t");
-
-  if (filaVazia(fila))
+  // Verifica se a fila tem pelo menos 3 peças
+  if (fila->tamanho < TAMANHO_PILHA)
   {
-    printf("(vazia)");
+    exibirMensagem("Erro: A fila deve ter pelo menos 3 peças para a troca múltipla!\n");
+    return 0;
   }
-  else
+
+  // Verifica se a pilha tem exatamente 3 peças
+  if (!pilhaCheia(pilha))
   {
-    int indice = fila->frente;
-    for (int i = 0; i < fila->tamanho; i++)
-    {
-      printf("[%c %d] ", fila->pecas[indice].nome, fila->pecas[indice].id);
-      indice = (indice + 1) % TAMANHO_FILA;
-    }
+    exibirMensagem("Erro: A pilha deve ter exatamente 3 peças para a troca múltipla!\n");
+    return 0;
   }
-  printf("\n");
+
+  aplicarTrocaMultipla(fila, pilha);
+
+  exibirMensagem("Ação: troca realizada entre os 3 primeiros da fila e os 3 da pilha!\n");
+  return 1;
 }
 
-// Função para exibir o estado atual da pilha
-void exibirPilha(PilhaReserva *pilha)
+// Função para acessar a última peça da fila (a mais recente inserida)
+Peca pecaDoFinal(FilaPecas *fila)
 {
-  printf("Pilha de reserva\t(Topo -> Base): ");
+  return fila->pecas[(fila->tras + TAMANHO_FILA - 1) % TAMANHO_FILA];
+}
 
-  if (pilhaVazia(pilha))
+// Função para inicializar o histórico de ações
+void inicializarHistorico(Historico *historico)
+{
+  historico->dados = NULL;
+  historico->capacidade = 0;
+  historico->total = 0;
+  historico->atual = 0;
+}
+
+// Função para liberar a memória do histórico
+void liberarHistorico(Historico *historico)
+{
+  free(historico->dados);
+  inicializarHistorico(historico);
+}
+
+// Função para calcular quantos bytes um registro ocupa no histórico
+int tamanhoRegistro(char acao)
+{
+  switch (acao)
+  {
+  case 1:
+  case 2:
+    return 2 + 2 * TAMANHO_PECA_REGISTRO;
+  case 3:
+    return 2 + TAMANHO_PECA_REGISTRO;
+  default:
+    return 2;
+  }
+}
+
+// Função para garantir espaço para mais um registro antes de executar uma ação
+// Assim uma ação nunca é aplicada sem poder ser registrada
+int reservarHistorico(Historico *historico)
+{
+  if (historico->atual + TAMANHO_MAXIMO_REGISTRO <= historico->capacidade)
+  {
+    return 1;
+  }
+
+  // A capacidade dobra a cada vez; se dobrar estourasse size_t, o histórico está cheio
+  if (historico->capacidade > SIZE_MAX / 2)
+  {
+    exibirMensagem("Erro: Histórico de ações cheio!\n");
+    return 0;
+  }
+
+  size_t novaCapacidade = historico->capacidade == 0 ? 64 * TAMANHO_MAXIMO_REGISTRO : historico->capacidade * 2;
+  unsigned char *novosDados = realloc(historico->dados, novaCapacidade);
+  if (novosDados == NULL)
+  {
+    exibirMensagem("Erro: Memória insuficiente para o histórico!\n");
+    return 0;
+  }
+  historico->dados = novosDados;
+  historico->capacidade = novaCapacidade;
+  return 1;
+}
+
+// Função para gravar uma peça compactada (nome e ID)
+unsigned char *escreverPecaRegistro(unsigned char *destino, Peca peca)
+{
+  destino[0] = (unsigned char)peca.nome;
+  memcpy(destino + 1, &peca.id, sizeof(peca.id));
+  return destino + TAMANHO_PECA_REGISTRO;
+}
+
+// Função para ler uma peça compactada
+const unsigned char *lerPecaRegistro(const unsigned char *origem, Peca *peca)
+{
+  peca->nome = (char)origem[0];
+  memcpy(&peca->id, origem + 1, sizeof(peca->id));
+  return origem + TAMANHO_PECA_REGISTRO;
+}
+
+// Função para ler o registro que começa na posição indicada; retorna o tamanho dele
+int lerRegistro(Historico *historico, size_t posicao, RegistroAcao *registro)
+{
+  const unsigned char *dados = historico->dados + posicao;
+  Peca pecaVazia = {' ', -1};
+
+  registro->acao = (char)dados[0];
+  registro->removida = pecaVazia;
+  registro->gerada = pecaVazia;
+  if (registro->acao >= 1 && registro->acao <= 3)
+  {
+    dados = lerPecaRegistro(dados + 1, &registro->removida);
+    if (registro->acao != 3)
+    {
+      lerPecaRegistro(dados, &registro->gerada);
+    }
+  }
+  return tamanhoRegistro(registro->acao);
+}
+
+// Função para ler o registro que termina na posição indicada; retorna a posição onde ele começa
+size_t lerRegistroAnterior(Historico *historico, size_t fim, RegistroAcao *registro)
+{
+  size_t inicio = fim - (size_t)tamanhoRegistro((char)historico->dados[fim - 1]);
+  lerRegistro(historico, inicio, registro);
+  return inicio;
+}
+
+// Função para descartar todos os registros, mantendo a memória já alocada
+// Usada por quem nunca desfaz ações, para o histórico não crescer sem limite
+void limparHistorico(Historico *historico)
+{
+  historico->total = 0;
+  historico->atual = 0;
+}
+
+// Função para registrar uma ação realizada (descarta as ações que poderiam ser refeitas)
+// O espaço precisa ter sido garantido antes com reservarHistorico
+void registrarAcao(Historico *historico, char acao, Peca removida, Peca gerada)
+{
+  unsigned char *destino = historico->dados + historico->atual;
+
+  *destino++ = (unsigned char)acao;
+  if (acao >= 1 && acao <= 3)
+  {
+    destino = escreverPecaRegistro(destino, removida);
+    if (acao != 3)
+    {
+      destino = escreverPecaRegistro(destino, gerada);
+    }
+  }
+  *destino = (unsigned char)acao;
+
+  historico->atual += (size_t)tamanhoRegistro(acao);
+  historico->total = historico->atual;
+}
+
+// Função para desfazer a última ação registrada
+int desfazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha)
+{
+  if (historico->atual == 0)
+  {
+    exibirMensagem("Erro: Não há ações para desfazer!\n");
+    return 0;
+  }
+
+  RegistroAcao registro;
+  historico->atual = lerRegistroAnterior(historico, historico->atual, &registro);
+
+  switch (registro.acao)
+  {
+  case 2:
+    // Retira da pilha a peça reservada e segue como na ação 1
+    pilha->topo--;
+    // fall through
+  case 1:
+    // Descarta a peça gerada no final da fila
+    fila->tras = (fila->tras + TAMANHO_FILA - 1) % TAMANHO_FILA;
+    // Devolve a peça removida para a frente da fila
+    fila->frente = (fila->frente + TAMANHO_FILA - 1) % TAMANHO_FILA;
+    fila->pecas[fila->frente] = registro.removida;
+    break;
+  case 3:
+    // Devolve a peça usada para o topo da pilha
+    pilha->topo++;
+    pilha->pecas[pilha->topo] = registro.removida;
+    break;
+  case 4:
+    aplicarTrocaAtual(fila, pilha);
+    break;
+  case 5:
+    aplicarTrocaMultipla(fila, pilha);
+    break;
+  }
+
+  exibirMensagem("Ação: última ação desfeita!\n");
+  return 1;
+}
+
+// Função para refazer a última ação desfeita
+int refazerAcao(Historico *historico, FilaPecas *fila, PilhaReserva *pilha)
+{
+  if (historico->atual == historico->total)
+  {
+    exibirMensagem("Erro: Não há ações para refazer!\n");
+    return 0;
+  }
+
+  RegistroAcao registro;
+  historico->atual += (size_t)lerRegistro(historico, historico->atual, &registro);
+
+  switch (registro.acao)
+  {
+  case 2:
+    // Recoloca a peça na pilha e segue como na ação 1
+    pilha->topo++;
+    pilha->pecas[pilha->topo] = registro.removida;
+    // fall through
+  case 1:
+    // Remove a peça da frente e reinsere a mesma peça gerada antes
+    fila->frente = (fila->frente + 1) % TAMANHO_FILA;
+    fila->pecas[fila->tras] = registro.gerada;
+    fila->tras = (fila->tras + 1) % TAMANHO_FILA;
+    break;
+  case 3:
+    pilha->topo--;
+    break;
+  case 4:
+    aplicarTrocaAtual(fila, pilha);
+    break;
+  case 5:
+    aplicarTrocaMultipla(fila, pilha);
+    break;
+  }
+
+  exibirMensagem("Ação: ação refeita!\n");
+  return 1;
+}
+
+// Função para exibir o estado atual da fila
+void exibirFila(FilaPecas *fila)
+{
+  printf("Fila de peças\t");
+
+  if (filaVazia(fila))
+  {
+    printf("(vazia)");
+  }
+  else
+  {
+    int indice = fila->frente;
+    for (int i = 0; i < fila->tamanho; i++)
+    {
+      printf("[%c %lld] ", fila->pecas[indice].nome, fila->pecas[indice].id);
+      indice = (indice + 1) % TAMANHO_FILA;
+    }
+  }
+  printf("\n");
+}
+
+// Função para exibir o estado atual da pilha
+void exibirPilha(PilhaReserva *pilha)
+{
+  printf("Pilha de reserva\t(Topo -> Base): ");
+
+  if (pilhaVazia(pilha))
   {
     printf("(vazia)");
   }
@@ -318,7 +1105,7 @@ void exibirPilha(PilhaReserva *pilha)
   {
     for (int i = pilha->topo; i >= 0; i--)
     {
-      printf("[%c %d] ", pilha->pecas[i].nome, pilha->pecas[i].id);
+      printf("[%c %lld] ", pilha->pecas[i].nome, pilha->pecas[i].id);
     }
   }
   printf("\n");
@@ -333,6 +1120,66 @@ void exibirEstado(FilaPecas *fila, PilhaReserva *pilha)
   printf("\n");
 }
 
+// Função para exibir as estatísticas das peças geradas
+void exibirEstatisticas(EstatisticasPecas *estatisticas)
+{
+  char tipos[] = {'I', 'O', 'T', 'L'};
+
+  printf("\n=== Estatísticas das peças (%lld geradas) ===\n", estatisticas->total);
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    // A seca em andamento também conta, pois o tipo pode estar sumido agora
+    long long secaAtual = estatisticas->total - estatisticas->ultimaPosicao[i] - 1;
+    long long maiorSeca = secaAtual > estatisticas->maiorSeca[i] ? secaAtual : estatisticas->maiorSeca[i];
+    double frequencia = estatisticas->total > 0 ? 100.0 * estatisticas->contagem[i] / estatisticas->total : 0;
+
+    printf("%c: %lld (%.1f%%), maior seca: %lld\n", tipos[i], estatisticas->contagem[i], frequencia, maiorSeca);
+  }
+  printf("Maior sequência de peças iguais: %d\n", estatisticas->maiorSequencia);
+  printf("Secas suspeitas (%d peças sem um tipo): %d\n", SECA_SUSPEITA, estatisticas->secasSuspeitas);
+
+  if (estatisticas->janelasCompletas > 0)
+  {
+    printf("Qui-quadrado da última janela de %d peças: %.3f (%s)\n", JANELA_ESTATISTICAS,
+           estatisticas->ultimoQuiQuadrado,
+           estatisticas->ultimoQuiQuadrado > QUI_QUADRADO_CRITICO ? "suspeito" : "ok");
+    printf("Janelas suspeitas: %d de %d\n", estatisticas->janelasReprovadas, estatisticas->janelasCompletas);
+  }
+  else
+  {
+    printf("Qui-quadrado: aguardando a primeira janela de %d peças\n", JANELA_ESTATISTICAS);
+  }
+}
+
+// Função para exportar as estatísticas em uma linha CSV
+// Campos: total, contagem e maior seca de cada tipo, maior sequência, último qui-quadrado,
+// janelas suspeitas, janelas completas e secas suspeitas
+void exportarEstatisticas(EstatisticasPecas *estatisticas, FILE *saida)
+{
+  fprintf(saida, "%lld", estatisticas->total);
+  for (int i = 0; i < TIPOS_PECA; i++)
+  {
+    fprintf(saida, ",%lld,%lld", estatisticas->contagem[i], estatisticas->maiorSeca[i]);
+  }
+  fprintf(saida, ",%d,%.3f,%d,%d,%d\n", estatisticas->maiorSequencia, estatisticas->ultimoQuiQuadrado,
+          estatisticas->janelasReprovadas, estatisticas->janelasCompletas, estatisticas->secasSuspeitas);
+}
+
+// Função para exportar o resumo das últimas janelas em CSV (uma linha por janela guardada)
+// Campos: número da janela, contagem de cada tipo, qui-quadrado, resultado
+void exportarJanelas(EstatisticasPecas *estatisticas, FILE *saida)
+{
+  int guardadas = estatisticas->janelasCompletas < JANELAS_GUARDADAS ? estatisticas->janelasCompletas : JANELAS_GUARDADAS;
+
+  for (int i = estatisticas->janelasCompletas - guardadas; i < estatisticas->janelasCompletas; i++)
+  {
+    ResumoJanela *janela = &estatisticas->janelas[i % JANELAS_GUARDADAS];
+    fprintf(saida, "%d,%d,%d,%d,%d,%.3f,%s\n", i + 1,
+            janela->contagem[0], janela->contagem[1], janela->contagem[2], janela->contagem[3],
+            janela->quiQuadrado, janela->quiQuadrado > QUI_QUADRADO_CRITICO ? "suspeito" : "ok");
+  }
+}
+
 // Função para exibir o menu de opções
 void exibirMenu()
 {
@@ -342,94 +1189,2238 @@ void exibirMenu()
   printf("3 - Usar peça da pilha de reserva\n");
   printf("4 - Trocar peça da frente da fila com o topo da pilha\n");
   printf("5 - Trocar os 3 primeiros da fila com as 3 peças da pilha\n");
+  printf("6 - Desfazer a última ação\n");
+  printf("7 - Refazer a ação desfeita\n");
+  printf("8 - Exibir estatísticas das peças geradas\n");
   printf("0 - Sair\n");
   printf("Escolha uma opção: ");
 }
 
-int main()
+// Função para preparar a tela do modo terminal
+void iniciarTela(Tela *tela)
 {
-  // Configuração simplificada que funciona melhor no Windows
-  system("chcp 65001 > nul");
-  setlocale(LC_ALL, "C.UTF-8");
+  memset(tela, 0, sizeof(Tela));
+  tela->primeiroQuadro = 1;
+}
 
-  // Inicializa o gerador de números aleatórios
-  srand(time(NULL));
+// Função para escrever uma linha do próximo quadro
+void escreverNaTela(Tela *tela, int linha, const char *formato, ...)
+{
+  va_list argumentos;
+  va_start(argumentos, formato);
+  vsnprintf(tela->atual[linha], TAMANHO_LINHA_TELA, formato, argumentos);
+  va_end(argumentos);
+}
 
-  FilaPecas fila;
-  PilhaReserva pilha;
-  int opcao;
+// Função para escrever uma sequência de peças em uma linha da tela
+void escreverPecas(char *destino, int tamanhoDestino, Peca *pecas, int quantidade)
+{
+  int usado = (int)strlen(destino);
+  for (int i = 0; i < quantidade && usado < tamanhoDestino; i++)
+  {
+    usado += snprintf(destino + usado, tamanhoDestino - usado, "[%c %lld] ", pecas[i].nome, pecas[i].id);
+  }
+}
 
-  // Inicializa as estruturas
-  inicializarFila(&fila);
-  inicializarPilha(&pilha);
+// Função para montar o quadro com o estado da sessão
+void desenharEstado(Tela *tela, Sessao *sessao)
+{
+  Peca pecas[TAMANHO_FILA];
+  int linha = 0;
 
-  printf("=== TETRIS STACK - DESAFIO MESTRE ===\n");
-  printf("Gerenciador avançado de peças com trocas entre fila e pilha\n");
+  escreverNaTela(tela, linha++, "=== TETRIS STACK - DESAFIO MESTRE ===");
+  escreverNaTela(tela, linha++, "");
 
-  do
+  // Fila da frente para o final
+  int indice = sessao->fila.frente;
+  for (int i = 0; i < sessao->fila.tamanho; i++)
   {
-    // Exibe o estado atual do jogo
-    exibirEstado(&fila, &pilha);
+    pecas[i] = sessao->fila.pecas[indice];
+    indice = (indice + 1) % TAMANHO_FILA;
+  }
+  escreverNaTela(tela, linha, "Fila de peças     ");
+  escreverPecas(tela->atual[linha++], TAMANHO_LINHA_TELA, pecas, sessao->fila.tamanho);
 
-    // Exibe o menu e lê a opção do usuário
-    exibirMenu();
-    scanf("%d", &opcao);
+  // Pilha do topo para a base
+  for (int i = 0; i <= sessao->pilha.topo; i++)
+  {
+    pecas[i] = sessao->pilha.pecas[sessao->pilha.topo - i];
+  }
+  escreverNaTela(tela, linha, "Pilha de reserva  ");
+  escreverPecas(tela->atual[linha++], TAMANHO_LINHA_TELA, pecas, sessao->pilha.topo + 1);
 
-    switch (opcao)
-    {
-    case 1:
+  escreverNaTela(tela, linha++, "Peças geradas: %lld (I %lld, O %lld, T %lld, L %lld)", estatisticas.total,
+                 estatisticas.contagem[0], estatisticas.contagem[1], estatisticas.contagem[2], estatisticas.contagem[3]);
+  escreverNaTela(tela, linha++, "");
+
+  escreverNaTela(tela, linha++, "1 - Jogar    2 - Reservar    3 - Usar reservada    4 - Trocar frente/topo");
+  escreverNaTela(tela, linha++, "5 - Troca múltipla    6 - Desfazer    7 - Refazer    0 - Sair");
+  escreverNaTela(tela, linha++, "");
+  escreverNaTela(tela, linha++, "%s", mensagemTela);
+
+  // Linhas restantes ficam em branco, exceto a de entrada
+  while (linha < LINHA_ENTRADA_TELA)
+  {
+    escreverNaTela(tela, linha++, "");
+  }
+  escreverNaTela(tela, linha++, "Escolha uma opção: ");
+  while (linha < LINHAS_TELA)
+  {
+    escreverNaTela(tela, linha++, "");
+  }
+}
+
+// Função para contar as colunas ocupadas por um trecho em UTF-8
+int colunasUtf8(const char *texto, int bytes)
+{
+  int colunas = 0;
+  for (int i = 0; i < bytes; i++)
+  {
+    // Bytes de continuação (10xxxxxx) não ocupam uma nova coluna
+    if (((unsigned char)texto[i] & 0xC0) != 0x80)
     {
-      // Jogar uma peça (remover da frente da fila)
-      Peca pecaJogada = jogarPeca(&fila);
-      if (pecaJogada.id != -1)
-      {
-        printf("Ação: peça [%c %d] foi jogada!\n", pecaJogada.nome, pecaJogada.id);
-        // Adiciona nova peça à fila para manter o tamanho
-        inserirPeca(&fila);
-      }
-      break;
+      colunas++;
     }
-    case 2:
+  }
+  return colunas;
+}
+
+// Função para enviar ao terminal apenas as diferenças em relação ao quadro anterior
+// Todo o quadro sai em uma única escrita
+void atualizarTela(Tela *tela, int linhaCursor)
+{
+  static char saida[LINHAS_TELA * (TAMANHO_LINHA_TELA + 16) + 64];
+  int usado = 0;
+
+  if (tela->primeiroQuadro)
+  {
+    usado += sprintf(saida + usado, "\033[2J");
+  }
+
+  for (int linha = 0; linha < LINHAS_TELA; linha++)
+  {
+    char *atual = tela->atual[linha];
+    char *anterior = tela->anterior[linha];
+
+    // A linha do cursor sempre é redesenhada, pois o terminal ecoa o que foi digitado
+    if (!tela->primeiroQuadro && linha != linhaCursor && strcmp(atual, anterior) == 0)
     {
-      // Reservar uma peça (move da fila para a pilha)
-      reservarPeca(&fila, &pilha);
-      break;
+      continue;
     }
-    case 3:
+
+    // Primeiro byte diferente, recuado até o início do caractere UTF-8
+    int inicio = 0;
+    if (!tela->primeiroQuadro && linha != linhaCursor)
     {
-      // Usar uma peça reservada (remove do topo da pilha)
-      usarPecaReservada(&pilha);
-      break;
+      while (atual[inicio] != '\0' && atual[inicio] == anterior[inicio])
+      {
+        inicio++;
+      }
+      while (inicio > 0 && ((unsigned char)atual[inicio] & 0xC0) == 0x80)
+      {
+        inicio--;
+      }
     }
-    case 4:
+
+    // Posiciona o cursor, escreve o restante da linha e apaga o que sobrou do quadro anterior
+    usado += sprintf(saida + usado, "\033[%d;%dH%s\033[K", linha + 1, colunasUtf8(atual, inicio) + 1, atual + inicio);
+    strcpy(anterior, atual);
+  }
+
+  // Deixa o cursor no final da linha de entrada
+  usado += sprintf(saida + usado, "\033[%d;%dH", linhaCursor + 1,
+                   colunasUtf8(tela->atual[linhaCursor], (int)strlen(tela->atual[linhaCursor])) + 1);
+
+  fwrite(saida, 1, usado, stdout);
+  fflush(stdout);
+  tela->primeiroQuadro = 0;
+}
+
+// Função para copiar os campos quentes da fila e da pilha para o cabeçalho da sessão
+void atualizarCabecalho(Sessao *sessao)
+{
+  CabecalhoSessao *cabecalho = &sessao->cabecalho;
+  cabecalho->frente = (signed char)sessao->fila.frente;
+  cabecalho->tras = (signed char)sessao->fila.tras;
+  cabecalho->tamanho = (signed char)sessao->fila.tamanho;
+  cabecalho->topo = (signed char)sessao->pilha.topo;
+  cabecalho->tipoFrente = sessao->fila.tamanho > 0 ? sessao->fila.pecas[sessao->fila.frente].nome : ' ';
+}
+
+// Função para preencher o estado inicial de uma sessão
+// O histórico anterior já precisa ter sido liberado (sessão nova ou encerrada)
+void prepararSessao(Sessao *sessao, unsigned int semente)
+{
+  inicializarFila(&sessao->fila, semente);
+  inicializarPilha(&sessao->pilha);
+  inicializarHistorico(&sessao->historico);
+  sessao->ativa = 1;
+  atualizarCabecalho(sessao);
+}
+
+// Função para inicializar uma sessão avulsa (fora de um conjunto, sem consultas)
+void inicializarSessao(Sessao *sessao, unsigned int semente)
+{
+  sessao->pool = NULL;
+  sessao->emUso = 1;
+  prepararSessao(sessao, semente);
+}
+
+// Função para publicar o resumo da sessão nos vetores do seu conjunto
+// Só a thread dona do conjunto escreve, então a versão é lida e gravada sem
+// operação atômica de leitura e escrita: fica ímpar durante a cópia e volta a ser par
+void publicarResumo(Sessao *sessao)
+{
+  PoolSessoes *pool = sessao->pool;
+  if (pool == NULL)
+  {
+    return;
+  }
+
+  int indice = (int)(sessao - pool->sessoes);
+  _Atomic unsigned int *versao = &pool->versoes[indice / TAMANHO_TRECHO_CONSULTA];
+  unsigned int valor = atomic_load_explicit(versao, memory_order_relaxed);
+
+  atomic_store_explicit(versao, valor + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  // Tudo vem dos primeiros 16 bytes da sessão
+  atomic_store_explicit(&pool->ativas[indice], sessao->ativa, memory_order_relaxed);
+  atomic_store_explicit(&pool->tamanhosFila[indice], sessao->cabecalho.tamanho, memory_order_relaxed);
+  atomic_store_explicit(&pool->topos[indice], sessao->cabecalho.topo, memory_order_relaxed);
+  atomic_store_explicit(&pool->frentes[indice], sessao->cabecalho.tipoFrente, memory_order_relaxed);
+
+  atomic_store_explicit(versao, valor + 2, memory_order_release);
+}
+
+// Função para liberar os recursos de uma sessão encerrada
+void encerrarSessao(Sessao *sessao)
+{
+  liberarHistorico(&sessao->historico);
+  sessao->ativa = 0;
+}
+
+// Função para alocar memória alinhada à linha de cache
+void *alocarAlinhado(size_t tamanho)
+{
+  // O tamanho precisa ser múltiplo do alinhamento
+  tamanho = (tamanho + TAMANHO_LINHA_CACHE - 1) / TAMANHO_LINHA_CACHE * TAMANHO_LINHA_CACHE;
+#ifdef _WIN32
+  return _aligned_malloc(tamanho, TAMANHO_LINHA_CACHE);
+#else
+  return aligned_alloc(TAMANHO_LINHA_CACHE, tamanho);
+#endif
+}
+
+// Função para liberar memória obtida com alocarAlinhado
+void liberarAlinhado(void *memoria)
+{
+#ifdef _WIN32
+  _aligned_free(memoria);
+#else
+  free(memoria);
+#endif
+}
+
+// Função para criar o conjunto de sessões de uma thread de trabalho
+// Deve ser chamada pela própria thread que vai usar as sessões: a memória é
+// preenchida aqui, e o Linux coloca cada página no nó NUMA de quem a toca primeiro.
+// As sessões guardam o endereço do conjunto, então ele não pode ser movido depois
+int criarPoolSessoes(PoolSessoes *pool, int capacidade)
+{
+  // Cada vetor do resumo ocupa trechos inteiros, então todos começam em uma linha de cache
+  pool->trechos = (capacidade + TAMANHO_TRECHO_CONSULTA - 1) / TAMANHO_TRECHO_CONSULTA;
+  size_t tamanhoVetor = (size_t)pool->trechos * TAMANHO_TRECHO_CONSULTA;
+  size_t tamanhoResumo = 4 * tamanhoVetor + (size_t)pool->trechos * sizeof(_Atomic unsigned int);
+
+  pool->sessoes = alocarAlinhado((size_t)capacidade * sizeof(Sessao));
+  unsigned char *resumo = alocarAlinhado(tamanhoResumo);
+  if (pool->sessoes == NULL || resumo == NULL)
+  {
+    printf("Erro: Memória insuficiente para o conjunto de sessões!\n");
+    liberarAlinhado(pool->sessoes);
+    liberarAlinhado(resumo);
+    pool->sessoes = NULL;
+    return 0;
+  }
+
+  memset(pool->sessoes, 0, (size_t)capacidade * sizeof(Sessao));
+  pool->ativas = (_Atomic signed char *)resumo;
+  pool->tamanhosFila = (_Atomic signed char *)(resumo + tamanhoVetor);
+  pool->topos = (_Atomic signed char *)(resumo + 2 * tamanhoVetor);
+  pool->frentes = (_Atomic char *)(resumo + 3 * tamanhoVetor);
+  pool->versoes = (_Atomic unsigned int *)(resumo + 4 * tamanhoVetor);
+  for (size_t i = 0; i < tamanhoVetor; i++)
+  {
+    atomic_init(&pool->ativas[i], 0);
+    atomic_init(&pool->tamanhosFila[i], 0);
+    atomic_init(&pool->topos[i], 0);
+    atomic_init(&pool->frentes[i], 0);
+  }
+  for (int i = 0; i < pool->trechos; i++)
+  {
+    atomic_init(&pool->versoes[i], 0);
+  }
+
+  for (int i = 0; i < capacidade; i++)
+  {
+    pool->sessoes[i].pool = pool;
+  }
+  pool->capacidade = capacidade;
+  pool->proximaLivre = 0;
+  pool->emUso = 0;
+  return 1;
+}
+
+// Função para obter uma sessão livre do conjunto, já inicializada
+// Retorna NULL se todas as sessões estão em uso
+Sessao *obterSessao(PoolSessoes *pool, unsigned int semente)
+{
+  if (pool->emUso == pool->capacidade)
+  {
+    return NULL;
+  }
+
+  // Uma sessão encerrada pela opção 0 continua em uso até ser devolvida
+  while (pool->sessoes[pool->proximaLivre].emUso)
+  {
+    pool->proximaLivre = (pool->proximaLivre + 1) % pool->capacidade;
+  }
+
+  Sessao *sessao = &pool->sessoes[pool->proximaLivre];
+  pool->proximaLivre = (pool->proximaLivre + 1) % pool->capacidade;
+  pool->emUso++;
+
+  sessao->emUso = 1;
+  prepararSessao(sessao, semente);
+  publicarResumo(sessao);
+  return sessao;
+}
+
+// Função para devolver uma sessão ao conjunto
+void devolverSessao(PoolSessoes *pool, Sessao *sessao)
+{
+  encerrarSessao(sessao);
+  sessao->emUso = 0;
+  publicarResumo(sessao);
+  pool->emUso--;
+}
+
+// Função para consultar o estado de todas as sessões de vários conjuntos
+// Só lê os vetores de resumo, então pode rodar junto com as threads que estão jogando.
+// Cada trecho é somado em contadores locais e só entra no resultado se a versão não mudou
+void consultarSessoes(PoolSessoes *pools, int totalPools, ConsultaSessoes *resultado)
+{
+  memset(resultado, 0, sizeof(ConsultaSessoes));
+
+  for (int p = 0; p < totalPools; p++)
+  {
+    PoolSessoes *pool = &pools[p];
+
+    for (int t = 0; t < pool->trechos; t++)
     {
-      // Trocar peça da frente da fila com o topo da pilha
-      trocarPecaAtual(&fila, &pilha);
-      break;
+      _Atomic unsigned int *versao = &pool->versoes[t];
+      int inicio = t * TAMANHO_TRECHO_CONSULTA;
+      int ativas, cheias, trocas, frenteI, frenteO, frenteT, frenteL;
+      unsigned int antes, depois;
+
+      do
+      {
+        antes = atomic_load_explicit(versao, memory_order_acquire);
+        ativas = cheias = trocas = frenteI = frenteO = frenteT = frenteL = 0;
+
+        // Contagens sem desvios: cada condição soma 0 ou 1
+        // As posições depois da última sessão estão zeradas e não contam
+        for (int i = inicio; i < inicio + TAMANHO_TRECHO_CONSULTA; i++)
+        {
+          int ativa = atomic_load_explicit(&pool->ativas[i], memory_order_relaxed);
+          int cheia = ativa & (atomic_load_explicit(&pool->topos[i], memory_order_relaxed) == TAMANHO_PILHA - 1);
+          char frente = atomic_load_explicit(&pool->frentes[i], memory_order_relaxed);
+          ativas += ativa;
+          cheias += cheia;
+          trocas += cheia & (atomic_load_explicit(&pool->tamanhosFila[i], memory_order_relaxed) >= TAMANHO_PILHA);
+          frenteI += ativa & (frente == 'I');
+          frenteO += ativa & (frente == 'O');
+          frenteT += ativa & (frente == 'T');
+          frenteL += ativa & (frente == 'L');
+        }
+
+        atomic_thread_fence(memory_order_acquire);
+        depois = atomic_load_explicit(versao, memory_order_relaxed);
+      } while ((antes & 1) != 0 || antes != depois);
+
+      resultado->sessoesAtivas += ativas;
+      resultado->pilhasCheias += cheias;
+      resultado->trocaMultiplaPossivel += trocas;
+      resultado->frentePorTipo[0] += frenteI;
+      resultado->frentePorTipo[1] += frenteO;
+      resultado->frentePorTipo[2] += frenteT;
+      resultado->frentePorTipo[3] += frenteL;
     }
-    case 5:
+  }
+}
+
+// Função para liberar o conjunto de sessões
+void liberarPoolSessoes(PoolSessoes *pool)
+{
+  // Libera o histórico de toda sessão não devolvida, mesmo das já encerradas pela opção 0
+  for (int i = 0; i < pool->capacidade; i++)
+  {
+    if (pool->sessoes[i].emUso)
     {
-      // Troca múltipla: 3 primeiras da fila com 3 da pilha
-      trocaMultipla(&fila, &pilha);
-      break;
+      encerrarSessao(&pool->sessoes[i]);
     }
-    case 0:
-      printf("Saindo do programa...\n");
+  }
+
+  liberarAlinhado(pool->sessoes);
+  liberarAlinhado(pool->ativas);
+  pool->sessoes = NULL;
+  pool->ativas = NULL;
+  pool->tamanhosFila = NULL;
+  pool->topos = NULL;
+  pool->frentes = NULL;
+  pool->versoes = NULL;
+  pool->capacidade = 0;
+  pool->trechos = 0;
+  pool->emUso = 0;
+}
+
+// Função para executar uma ação do menu em uma sessão
+// Se pecaNoCampo não for NULL, recebe a peça que a ação colocou no campo
+// (ações 1 e 3), ou uma peça vazia nas demais
+// Retorna 1 enquanto a sessão continua ativa, aguardando a próxima entrada
+int executarAcao(Sessao *sessao, int opcao, Peca *pecaNoCampo)
+{
+  Peca pecaVazia = {' ', -1};
+  if (pecaNoCampo != NULL)
+  {
+    *pecaNoCampo = pecaVazia;
+  }
+
+  // As ações 1 a 5 só são aplicadas se houver espaço para registrá-las no histórico
+  if (opcao >= 1 && opcao <= 5 && !reservarHistorico(&sessao->historico))
+  {
+    return sessao->ativa;
+  }
+
+  switch (opcao)
+  {
+  case 1:
+  {
+    // Jogar uma peça (remover da frente da fila)
+    Peca pecaJogada = jogarPeca(&sessao->fila);
+    if (pecaJogada.id != -1)
+    {
+      exibirMensagem("Ação: peça [%c %lld] foi jogada!\n", pecaJogada.nome, pecaJogada.id);
+      // Adiciona nova peça à fila para manter o tamanho
+      inserirPeca(&sessao->fila);
+      registrarAcao(&sessao->historico, 1, pecaJogada, pecaDoFinal(&sessao->fila));
+      if (pecaNoCampo != NULL)
+      {
+        *pecaNoCampo = pecaJogada;
+      }
+    }
+    break;
+  }
+  case 2:
+  {
+    // Reservar uma peça (move da fila para a pilha)
+    if (reservarPeca(&sessao->fila, &sessao->pilha))
+    {
+      registrarAcao(&sessao->historico, 2, sessao->pilha.pecas[sessao->pilha.topo], pecaDoFinal(&sessao->fila));
+    }
+    break;
+  }
+  case 3:
+  {
+    // Usar uma peça reservada (remove do topo da pilha)
+    Peca pecaTopo = pilhaVazia(&sessao->pilha) ? pecaVazia : sessao->pilha.pecas[sessao->pilha.topo];
+    if (usarPecaReservada(&sessao->pilha))
+    {
+      registrarAcao(&sessao->historico, 3, pecaTopo, pecaTopo);
+      if (pecaNoCampo != NULL)
+      {
+        *pecaNoCampo = pecaTopo;
+      }
+    }
+    break;
+  }
+  case 4:
+  {
+    // Trocar peça da frente da fila com o topo da pilha
+    if (trocarPecaAtual(&sessao->fila, &sessao->pilha))
+    {
+      registrarAcao(&sessao->historico, 4, pecaVazia, pecaVazia);
+    }
+    break;
+  }
+  case 5:
+  {
+    // Troca múltipla: 3 primeiras da fila com 3 da pilha
+    if (trocaMultipla(&sessao->fila, &sessao->pilha))
+    {
+      registrarAcao(&sessao->historico, 5, pecaVazia, pecaVazia);
+    }
+    break;
+  }
+  case 6:
+  {
+    // Desfazer a última ação
+    desfazerAcao(&sessao->historico, &sessao->fila, &sessao->pilha);
+    break;
+  }
+  case 7:
+  {
+    // Refazer a última ação desfeita
+    refazerAcao(&sessao->historico, &sessao->fila, &sessao->pilha);
+    break;
+  }
+  case 8:
+  {
+    // Exibir estatísticas das peças geradas (no modo terminal ficam sempre visíveis)
+    if (exibirMensagens && !modoTela)
+    {
+      exibirEstatisticas(&estatisticas);
+    }
+    break;
+  }
+  case 0:
+    exibirMensagem("Saindo do programa...\n");
+    sessao->ativa = 0;
+    break;
+  default:
+    exibirMensagem("Opção inválida! Tente novamente.\n");
+    break;
+  }
+
+  atualizarCabecalho(sessao);
+  publicarResumo(sessao);
+  return sessao->ativa;
+}
+
+// Função para calcular um resumo (hash FNV-1a) do estado lógico da sessão
+// Considera a fila da frente para o final e a pilha da base para o topo
+unsigned long long hashEstado(Sessao *sessao)
+{
+  unsigned long long hash = 14695981039346656037ULL;
+  long long valores[2 * (TAMANHO_FILA + TAMANHO_PILHA) + 2];
+  int quantidade = 0;
+
+  valores[quantidade++] = sessao->fila.tamanho;
+  int indice = sessao->fila.frente;
+  for (int i = 0; i < sessao->fila.tamanho; i++)
+  {
+    valores[quantidade++] = sessao->fila.pecas[indice].nome;
+    valores[quantidade++] = sessao->fila.pecas[indice].id;
+    indice = (indice + 1) % TAMANHO_FILA;
+  }
+
+  valores[quantidade++] = sessao->pilha.topo;
+  for (int i = 0; i <= sessao->pilha.topo; i++)
+  {
+    valores[quantidade++] = sessao->pilha.pecas[i].nome;
+    valores[quantidade++] = sessao->pilha.pecas[i].id;
+  }
+
+  for (int i = 0; i < quantidade; i++)
+  {
+    hash ^= (unsigned long long)valores[i];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
+// Função para copiar as peças em jogo (fila da frente para o final, depois a pilha)
+// Retorna quantas peças foram copiadas
+int coletarPecasEmJogo(Sessao *sessao, Peca emJogo[TAMANHO_FILA + TAMANHO_PILHA])
+{
+  FilaPecas *fila = &sessao->fila;
+  PilhaReserva *pilha = &sessao->pilha;
+  int quantidade = 0;
+
+  int indice = fila->frente;
+  for (int i = 0; i < fila->tamanho && i < TAMANHO_FILA; i++)
+  {
+    emJogo[quantidade++] = fila->pecas[indice];
+    indice = (indice + 1) % TAMANHO_FILA;
+  }
+  for (int i = 0; i <= pilha->topo && i < TAMANHO_PILHA; i++)
+  {
+    emJogo[quantidade++] = pilha->pecas[i];
+  }
+
+  return quantidade;
+}
+
+// Função para verificar as invariantes de uma sessão
+// Retorna NULL se o estado é válido ou a descrição da primeira violação
+const char *verificarInvariantes(Sessao *sessao)
+{
+  FilaPecas *fila = &sessao->fila;
+  PilhaReserva *pilha = &sessao->pilha;
+
+  // Índices da fila circular
+  if (fila->tamanho != TAMANHO_FILA)
+  {
+    return "a fila deveria estar sempre cheia";
+  }
+  if (fila->frente < 0 || fila->frente >= TAMANHO_FILA || fila->tras < 0 || fila->tras >= TAMANHO_FILA)
+  {
+    return "frente/tras fora dos limites";
+  }
+  if (fila->tras != (fila->frente + fila->tamanho) % TAMANHO_FILA)
+  {
+    return "tamanho inconsistente com frente/tras";
+  }
+
+  // Topo da pilha
+  if (pilha->topo < -1 || pilha->topo >= TAMANHO_PILHA)
+  {
+    return "topo da pilha fora dos limites";
+  }
+
+  // Histórico
+  if (sessao->historico.atual > sessao->historico.total || sessao->historico.total > sessao->historico.capacidade)
+  {
+    return "posição do histórico inconsistente";
+  }
+
+  // Cabeçalho quente igual à fila e à pilha
+  CabecalhoSessao *cabecalho = &sessao->cabecalho;
+  char tipoFrente = fila->tamanho > 0 ? fila->pecas[fila->frente].nome : ' ';
+  if (cabecalho->frente != fila->frente || cabecalho->tras != fila->tras || cabecalho->tamanho != fila->tamanho ||
+      cabecalho->topo != pilha->topo || cabecalho->tipoFrente != tipoFrente)
+  {
+    return "cabeçalho da sessão desatualizado";
+  }
+
+  // Peças em jogo: tipo válido, ID já emitido e sem repetição
+  Peca emJogo[TAMANHO_FILA + TAMANHO_PILHA];
+  int quantidade = coletarPecasEmJogo(sessao, emJogo);
+
+  for (int i = 0; i < quantidade; i++)
+  {
+    if (strchr("IOTL", emJogo[i].nome) == NULL || emJogo[i].nome == '\0')
+    {
+      return "peça com tipo inválido";
+    }
+    if (emJogo[i].id < 0 || emJogo[i].id >= atomic_load(&proximoBlocoId))
+    {
+      return "peça com ID nunca emitido";
+    }
+    for (int j = 0; j < i; j++)
+    {
+      if (emJogo[i].id == emJogo[j].id)
+      {
+        return "ID de peça repetido";
+      }
+    }
+  }
+
+  return NULL;
+}
+
+// Função para procurar uma peça (mesmo ID e mesmo tipo) em uma lista; retorna o índice ou -1
+int procurarPeca(const Peca *pecas, int quantidade, Peca peca)
+{
+  for (int i = 0; i < quantidade; i++)
+  {
+    if (pecas[i].id == peca.id && pecas[i].nome == peca.nome)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Função para verificar a conservação das peças em um passo
+// As peças em jogo depois do passo precisam ser as de antes, menos as que o registro aplicado
+// (ou desfeito) tirou e mais as que ele colocou; sem mudança no histórico, nada pode mudar
+const char *verificarConservacao(Sessao *sessao, const Peca *antes, int quantidadeAntes, size_t posicaoAntes)
+{
+  Historico *historico = &sessao->historico;
+  Peca esperado[TAMANHO_FILA + TAMANHO_PILHA + 1];
+  int quantidadeEsperada = quantidadeAntes;
+  memcpy(esperado, antes, quantidadeAntes * sizeof(Peca));
+
+  if (historico->atual != posicaoAntes)
+  {
+    // Ação nova ou refeita: o registro termina na posição atual; ação desfeita: começa nela
+    int avancou = historico->atual > posicaoAntes;
+    RegistroAcao registro;
+    if (avancou)
+    {
+      lerRegistroAnterior(historico, historico->atual, &registro);
+    }
+    else
+    {
+      lerRegistro(historico, historico->atual, &registro);
+    }
+
+    // As ações 1 e 3 tiram a peça removida do jogo; as ações 1 e 2 colocam a peça gerada
+    int tirou = registro.acao == 1 || registro.acao == 3;
+    int colocou = registro.acao == 1 || registro.acao == 2;
+    Peca saiu = avancou ? registro.removida : registro.gerada;
+    Peca entrou = avancou ? registro.gerada : registro.removida;
+    int saiuValida = avancou ? tirou : colocou;
+    int entrouValida = avancou ? colocou : tirou;
+
+    if (saiuValida)
+    {
+      int indice = procurarPeca(esperado, quantidadeEsperada, saiu);
+      if (indice == -1)
+      {
+        return "o histórico retirou uma peça que não estava em jogo";
+      }
+      esperado[indice] = esperado[--quantidadeEsperada];
+    }
+    if (entrouValida)
+    {
+      esperado[quantidadeEsperada++] = entrou;
+    }
+  }
+
+  Peca depois[TAMANHO_FILA + TAMANHO_PILHA];
+  int quantidadeDepois = coletarPecasEmJogo(sessao, depois);
+  if (quantidadeDepois != quantidadeEsperada)
+  {
+    return "peças criadas ou perdidas fora do histórico";
+  }
+  for (int i = 0; i < quantidadeDepois; i++)
+  {
+    if (procurarPeca(esperado, quantidadeEsperada, depois[i]) == -1)
+    {
+      return "peça trocada fora do histórico";
+    }
+  }
+
+  return NULL;
+}
+
+// Função para executar ações aleatórias verificando as invariantes após cada passo
+// A semente torna qualquer falha reproduzível
+int testarAleatoriamente(unsigned int semente, long long totalAcoes)
+{
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  // As opções vêm de um gerador próprio, separado do gerador das peças
+  unsigned int geradorAcoes = prepararSemente(semente ^ 0x9E3779B9u);
+
+  Sessao sessao;
+  inicializarSessao(&sessao, semente);
+
+  const char *violacao = verificarInvariantes(&sessao);
+  long long passo = 0;
+
+  while (violacao == NULL && passo < totalAcoes)
+  {
+    // Guarda as peças em jogo para conferir a conservação depois do passo
+    Peca antes[TAMANHO_FILA + TAMANHO_PILHA];
+    int quantidadeAntes = coletarPecasEmJogo(&sessao, antes);
+    size_t posicaoAntes = sessao.historico.atual;
+
+    // Opções de 1 a 7
+    int opcao = 1 + numeroAleatorio(&geradorAcoes) % 7;
+    executarAcao(&sessao, opcao, NULL);
+    passo++;
+    violacao = verificarInvariantes(&sessao);
+    if (violacao == NULL)
+    {
+      violacao = verificarConservacao(&sessao, antes, quantidadeAntes, posicaoAntes);
+    }
+  }
+
+  encerrarSessao(&sessao);
+
+  if (violacao != NULL)
+  {
+    printf("Invariante violada no passo %lld (semente %u): %s\n", passo, semente, violacao);
+    return 1;
+  }
+
+  printf("%lld ações executadas sem violações (semente %u).\n", passo, semente);
+  return 0;
+}
+
+// Função para inicializar a fila de lixo
+void inicializarFilaLixo(FilaLixo *fila)
+{
+  fila->frente = 0;
+  fila->tras = 0;
+  fila->tamanho = 0;
+}
+
+// Função para enviar um ataque para o final da fila de lixo (enqueue)
+// Retorna 0 se a fila está cheia
+int enviarLixo(FilaLixo *fila, int linhas)
+{
+  if (fila->tamanho == TAMANHO_FILA_LIXO)
+  {
+    return 0;
+  }
+
+  fila->linhas[fila->tras] = linhas;
+  fila->tras = (fila->tras + 1) % TAMANHO_FILA_LIXO;
+  fila->tamanho++;
+  return 1;
+}
+
+// Função para retirar o primeiro ataque da fila de lixo (dequeue)
+// Retorna 0 se não há ataques pendentes
+int receberLixo(FilaLixo *fila)
+{
+  if (fila->tamanho == 0)
+  {
+    return 0;
+  }
+
+  int linhas = fila->linhas[fila->frente];
+  fila->frente = (fila->frente + 1) % TAMANHO_FILA_LIXO;
+  fila->tamanho--;
+  return linhas;
+}
+
+// Função para eliminar um jogador da partida
+void eliminarJogador(Partida *partida, Jogador *jogador)
+{
+  if (jogador->vivo)
+  {
+    jogador->vivo = 0;
+    partida->vivos--;
+  }
+}
+
+// Função para inicializar uma partida versus (a semente define toda a partida)
+void inicializarPartida(Partida *partida, int quantidade, unsigned int semente)
+{
+  partida->quantidade = quantidade;
+  partida->vivos = quantidade;
+  partida->passo = 0;
+
+  // Todos recebem a mesma sequência de peças; as ações de cada jogador vêm de um gerador
+  // próprio, derivado da semente da partida e da posição do jogador
+  for (int i = 0; i < quantidade; i++)
+  {
+    inicializarSessao(&partida->jogadores[i].sessao, semente);
+    partida->jogadores[i].geradorAcoes = prepararSemente(semente ^ (0x9E3779B9u * (unsigned int)(i + 1)));
+    inicializarFilaLixo(&partida->jogadores[i].lixo);
+    partida->jogadores[i].altura = 0;
+    partida->jogadores[i].vivo = 1;
+  }
+}
+
+// Função para liberar os recursos de uma partida
+void encerrarPartida(Partida *partida)
+{
+  for (int i = 0; i < partida->quantidade; i++)
+  {
+    encerrarSessao(&partida->jogadores[i].sessao);
+  }
+}
+
+// Função para simular uma rodada: cada jogador vivo faz uma ação, na ordem
+// Como não há campo de jogo, cada peça 'I' jogada conta como uma linha completada:
+// ela cancela o primeiro ataque pendente ou, sem ataques, envia uma linha ao próximo adversário.
+// Qualquer outra peça jogada deixa cair o primeiro ataque pendente no campo.
+void passoPartida(Partida *partida)
+{
+  for (int i = 0; i < partida->quantidade && partida->vivos > 1; i++)
+  {
+    Jogador *jogador = &partida->jogadores[i];
+    if (!jogador->vivo)
+    {
+      continue;
+    }
+
+    // A ação vem do gerador do próprio jogador, então a partida é determinística
+    // Ninguém desfaz ações na partida, então o histórico não precisa ser guardado
+    Peca pecaNoCampo;
+    executarAcao(&jogador->sessao, 1 + numeroAleatorio(&jogador->geradorAcoes) % 5, &pecaNoCampo);
+    limparHistorico(&jogador->sessao.historico);
+
+    // Só as ações 1 e 3 colocam uma peça no campo
+    if (pecaNoCampo.id == -1)
+    {
+      continue;
+    }
+
+    if (pecaNoCampo.nome == 'I')
+    {
+      if (receberLixo(&jogador->lixo) == 0)
+      {
+        // Envia a linha ao próximo adversário vivo; fila de lixo cheia elimina o adversário
+        int alvo = (i + 1) % partida->quantidade;
+        while (!partida->jogadores[alvo].vivo)
+        {
+          alvo = (alvo + 1) % partida->quantidade;
+        }
+        if (!enviarLixo(&partida->jogadores[alvo].lixo, 1))
+        {
+          eliminarJogador(partida, &partida->jogadores[alvo]);
+        }
+      }
+    }
+    else
+    {
+      jogador->altura += receberLixo(&jogador->lixo);
+      if (jogador->altura >= ALTURA_MAXIMA)
+      {
+        eliminarJogador(partida, jogador);
+      }
+    }
+  }
+
+  partida->passo++;
+}
+
+// Função para simular várias partidas versus e exibir o resumo das vitórias
+// Cada partida usa a semente inicial somada ao seu número, então pode ser repetida isoladamente
+int simularPartidas(unsigned int semente, int quantidade, int totalPartidas)
+{
+  if (quantidade < 2 || quantidade > MAX_JOGADORES)
+  {
+    printf("Erro: Uma partida deve ter de 2 a %d jogadores!\n", MAX_JOGADORES);
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  Partida *partida = alocarAlinhado(sizeof(Partida));
+  if (partida == NULL)
+  {
+    printf("Erro: Memória insuficiente para a partida!\n");
+    return 1;
+  }
+
+  int vitorias[MAX_JOGADORES] = {0};
+  int empates = 0;
+  long long totalPassos = 0;
+
+  for (int p = 0; p < totalPartidas; p++)
+  {
+    inicializarPartida(partida, quantidade, semente + p);
+    while (partida->vivos > 1 && partida->passo < LIMITE_PASSOS_PARTIDA)
+    {
+      passoPartida(partida);
+    }
+
+    if (partida->vivos == 1)
+    {
+      for (int i = 0; i < quantidade; i++)
+      {
+        if (partida->jogadores[i].vivo)
+        {
+          vitorias[i]++;
+        }
+      }
+    }
+    else
+    {
+      empates++;
+    }
+
+    totalPassos += partida->passo;
+    encerrarPartida(partida);
+  }
+
+  printf("%d partidas com %d jogadores (semente %u)\n", totalPartidas, quantidade, semente);
+  for (int i = 0; i < quantidade; i++)
+  {
+    printf("Jogador %d: %d vitórias\n", i + 1, vitorias[i]);
+  }
+  printf("Sem vencedor: %d\n", empates);
+  if (totalPartidas > 0)
+  {
+    printf("Média de rodadas por partida: %.1f\n", (double)totalPassos / totalPartidas);
+  }
+
+  liberarAlinhado(partida);
+  return 0;
+}
+
+// Função para escrever um inteiro sem sinal com a quantidade de bytes indicada (little-endian)
+void escreverInteiro(FILE *arquivo, unsigned long long valor, int bytes)
+{
+  for (int i = 0; i < bytes; i++)
+  {
+    fputc((int)((valor >> (8 * i)) & 0xFF), arquivo);
+  }
+}
+
+// Função para ler um inteiro sem sinal escrito por escreverInteiro
+// Retorna 0 se o arquivo terminou antes (leitura incompleta)
+int lerInteiro(FILE *arquivo, int bytes, unsigned long long *valor)
+{
+  *valor = 0;
+  for (int i = 0; i < bytes; i++)
+  {
+    int byte = fgetc(arquivo);
+    if (byte == EOF)
+    {
+      return 0;
+    }
+    *valor |= (unsigned long long)byte << (8 * i);
+  }
+  return 1;
+}
+
+// Função para compactar opções de 0 a 5 em três por byte
+// Retorna a quantidade de bytes gerados
+int compactarAcoes(const unsigned char *acoes, int quantidade, unsigned char *saida)
+{
+  int bytes = 0;
+  for (int i = 0; i < quantidade; i += 3)
+  {
+    int a = acoes[i];
+    int b = i + 1 < quantidade ? acoes[i + 1] : 0;
+    int c = i + 2 < quantidade ? acoes[i + 2] : 0;
+    saida[bytes++] = (unsigned char)(a + ACOES_ARQUIVAVEIS * b + ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS * c);
+  }
+  return bytes;
+}
+
+// Função para descompactar opções geradas por compactarAcoes
+void descompactarAcoes(const unsigned char *dados, int quantidade, unsigned char *acoes)
+{
+  // Tabela com as três opções de cada valor de byte possível
+  static unsigned char tabela[ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS][3];
+  static int tabelaPronta = 0;
+
+  if (!tabelaPronta)
+  {
+    for (int v = 0; v < ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS; v++)
+    {
+      tabela[v][0] = v % ACOES_ARQUIVAVEIS;
+      tabela[v][1] = (v / ACOES_ARQUIVAVEIS) % ACOES_ARQUIVAVEIS;
+      tabela[v][2] = v / (ACOES_ARQUIVAVEIS * ACOES_ARQUIVAVEIS);
+    }
+    tabelaPronta = 1;
+  }
+
+  int completos = quantidade / 3;
+  for (int i = 0; i < completos; i++)
+  {
+    memcpy(&acoes[3 * i], tabela[dados[i]], 3);
+  }
+  for (int i = 3 * completos; i < quantidade; i++)
+  {
+    acoes[i] = tabela[dados[completos]][i - 3 * completos];
+  }
+}
+
+// Função para mudar a posição de um arquivo com deslocamento de 64 bits
+int posicionarArquivo(FILE *arquivo, unsigned long long deslocamento)
+{
+#ifdef _WIN32
+  return _fseeki64(arquivo, (__int64)deslocamento, SEEK_SET);
+#else
+  return fseeko(arquivo, (off_t)deslocamento, SEEK_SET);
+#endif
+}
+
+// Função para descobrir o tamanho de um arquivo aberto (volta ao início depois)
+// Retorna 0 em caso de erro
+int medirArquivo(FILE *arquivo, unsigned long long *tamanho)
+{
+#ifdef _WIN32
+  int ok = _fseeki64(arquivo, 0, SEEK_END) == 0;
+  long long fim = ok ? _ftelli64(arquivo) : -1;
+#else
+  int ok = fseeko(arquivo, 0, SEEK_END) == 0;
+  long long fim = ok ? (long long)ftello(arquivo) : -1;
+#endif
+  if (fim < 0 || posicionarArquivo(arquivo, 0) != 0)
+  {
+    return 0;
+  }
+  *tamanho = (unsigned long long)fim;
+  return 1;
+}
+
+// Função para ler o cabeçalho de uma gravação: "v<versão> semente sessao inicio"
+// Gravações sem versão usavam a semente sem embaralhar e não podem ser repetidas
+// Retorna 1 se o cabeçalho é válido, 0 se não pôde ser lido e -1 se a versão é outra
+int lerCabecalhoGravacao(FILE *arquivo, unsigned int *semente, unsigned int *sessao, long long *inicio)
+{
+  char linha[128];
+  int versao;
+  if (fgets(linha, sizeof(linha), arquivo) == NULL)
+  {
+    return 0;
+  }
+
+  if (sscanf(linha, "v%d", &versao) != 1 || versao != VERSAO_GRAVACAO)
+  {
+    // Uma linha que começa com número é uma gravação de antes da versão no cabeçalho
+    return linha[0] == 'v' || (linha[0] >= '0' && linha[0] <= '9') ? -1 : 0;
+  }
+  if (sscanf(linha, "v%*d %u %u %lld", semente, sessao, inicio) != 3)
+  {
+    return 0;
+  }
+  return 1;
+}
+
+// Função para avisar por que o cabeçalho de uma gravação foi recusado
+void exibirErroCabecalho(const char *caminho, int resultado)
+{
+  if (resultado < 0)
+  {
+    printf("Erro: A gravação %s é de outra versão (esta lê a versão %d)!\n", caminho, VERSAO_GRAVACAO);
+  }
+  else
+  {
+    printf("Erro: Não foi possível ler a gravação %s!\n", caminho);
+  }
+}
+
+// Função para ler as opções de uma gravação (--gravar) para a memória
+// As opções 8 e inválidas (de gravações antigas) não mudam o estado e são descartadas
+// Retorna a quantidade de opções lidas ou -1 em caso de erro
+int lerGravacao(const char *caminho, EntradaArquivo *entrada, unsigned char **acoes)
+{
+  FILE *arquivo = fopen(caminho, "r");
+  int cabecalho = arquivo != NULL ? lerCabecalhoGravacao(arquivo, &entrada->semente, &entrada->sessao, &entrada->inicio) : 0;
+  if (cabecalho != 1)
+  {
+    exibirErroCabecalho(caminho, cabecalho);
+    if (arquivo != NULL)
+    {
+      fclose(arquivo);
+    }
+    return -1;
+  }
+
+  int quantidade = 0;
+  int capacidade = 0;
+  int opcao;
+  *acoes = NULL;
+
+  while (fscanf(arquivo, "%d", &opcao) == 1)
+  {
+    if (opcao < 0 || opcao >= ACOES_GRAVAVEIS)
+    {
+      continue;
+    }
+
+    if (quantidade == capacidade)
+    {
+      capacidade = capacidade == 0 ? 256 : capacidade * 2;
+      unsigned char *novasAcoes = realloc(*acoes, capacidade);
+      if (novasAcoes == NULL)
+      {
+        printf("Erro: Memória insuficiente para a gravação!\n");
+        free(*acoes);
+        fclose(arquivo);
+        return -1;
+      }
+      *acoes = novasAcoes;
+    }
+    (*acoes)[quantidade++] = (unsigned char)opcao;
+  }
+
+  fclose(arquivo);
+  return quantidade;
+}
+
+// Função para escrever um número em 7 bits por byte (o bit mais alto indica que há mais bytes)
+unsigned char *escreverVarint(unsigned char *destino, unsigned long long valor)
+{
+  while (valor >= 0x80)
+  {
+    *destino++ = (unsigned char)(valor | 0x80);
+    valor >>= 7;
+  }
+  *destino++ = (unsigned char)valor;
+  return destino;
+}
+
+// Função para ler um número escrito por escreverVarint
+const unsigned char *lerVarint(const unsigned char *origem, const unsigned char *fim, unsigned long long *valor)
+{
+  *valor = 0;
+  for (int deslocamento = 0; origem < fim && deslocamento < 64; deslocamento += 7)
+  {
+    unsigned char byte = *origem++;
+    *valor |= (unsigned long long)(byte & 0x7F) << deslocamento;
+    if ((byte & 0x80) == 0)
+    {
+      return origem;
+    }
+  }
+  return NULL;
+}
+
+// Função para separar as opções de uma partida: 0 a 5 vão para a sequência compactada,
+// 6 e 7 para a lista de extras (distância desde o extra anterior e a opção)
+// Retorna a quantidade de opções que ficaram na sequência principal
+int separarAcoes(const unsigned char *acoes, int quantidade, unsigned char *principais,
+                 unsigned char *extras, int *bytesExtras, int *totalExtras)
+{
+  int totalPrincipais = 0;
+  int ultimaPosicao = 0;
+  unsigned char *destino = extras;
+
+  *totalExtras = 0;
+  for (int i = 0; i < quantidade; i++)
+  {
+    if (acoes[i] < ACOES_ARQUIVAVEIS)
+    {
+      principais[totalPrincipais++] = acoes[i];
+    }
+    else
+    {
+      destino = escreverVarint(destino, (unsigned long long)(i - ultimaPosicao));
+      *destino++ = acoes[i];
+      ultimaPosicao = i;
+      (*totalExtras)++;
+    }
+  }
+
+  *bytesExtras = (int)(destino - extras);
+  return totalPrincipais;
+}
+
+// Função para juntar a sequência principal e a lista de extras de volta na ordem original
+// Retorna 1 se a lista de extras é válida
+int juntarAcoes(const unsigned char *principais, const unsigned char *extras, const EntradaArquivo *entrada,
+                unsigned char *acoes)
+{
+  const unsigned char *leitura = extras;
+  const unsigned char *fim = extras + entrada->bytesExtras;
+  int proximoExtra = -1;
+  int restantes = entrada->extras;
+  int posicaoAnterior = 0;
+  unsigned char acaoExtra = 0;
+  int indicePrincipal = 0;
+
+  for (int i = 0; i < entrada->acoes; i++)
+  {
+    if (proximoExtra < i && restantes > 0)
+    {
+      unsigned long long distancia;
+      leitura = lerVarint(leitura, fim, &distancia);
+      if (leitura == NULL || leitura >= fim || distancia > (unsigned long long)entrada->acoes)
+      {
+        return 0;
+      }
+      proximoExtra = posicaoAnterior + (int)distancia;
+      posicaoAnterior = proximoExtra;
+      acaoExtra = *leitura++;
+      restantes--;
+    }
+
+    if (i == proximoExtra)
+    {
+      acoes[i] = acaoExtra;
+    }
+    else
+    {
+      acoes[i] = principais[indicePrincipal++];
+    }
+  }
+
+  return restantes == 0 && indicePrincipal == entrada->acoes - entrada->extras;
+}
+
+// Função para gravar uma entrada do índice
+void escreverEntradaIndice(FILE *arquivo, const EntradaArquivo *entrada)
+{
+  escreverInteiro(arquivo, entrada->sessao, 4);
+  escreverInteiro(arquivo, entrada->semente, 4);
+  escreverInteiro(arquivo, (unsigned long long)entrada->inicio, 8);
+  escreverInteiro(arquivo, (unsigned long long)entrada->fim, 8);
+  escreverInteiro(arquivo, entrada->acoes, 4);
+  escreverInteiro(arquivo, entrada->extras, 4);
+  escreverInteiro(arquivo, entrada->bytesExtras, 4);
+  escreverInteiro(arquivo, entrada->deslocamento, 8);
+}
+
+// Função para ler uma entrada do índice e conferir se ela cabe no arquivo
+// Retorna 0 se a entrada está incompleta ou aponta para fora do arquivo
+int lerEntradaIndice(FILE *arquivo, unsigned long long tamanhoArquivo, EntradaArquivo *entrada)
+{
+  unsigned long long campos[8];
+  int larguras[8] = {4, 4, 8, 8, 4, 4, 4, 8};
+
+  for (int i = 0; i < 8; i++)
+  {
+    if (!lerInteiro(arquivo, larguras[i], &campos[i]))
+    {
+      return 0;
+    }
+  }
+
+  // Ações, extras e bytes dos extras precisam ser coerentes antes de virar int
+  unsigned long long acoes = campos[4], extras = campos[5], bytesExtras = campos[6];
+  if (acoes > 0x7FFFFFFF || extras > acoes || bytesExtras > 6 * extras)
+  {
+    return 0;
+  }
+  unsigned long long bytesPrincipais = (acoes - extras + 2) / 3;
+  if (campos[7] > tamanhoArquivo || bytesPrincipais + bytesExtras > tamanhoArquivo - campos[7])
+  {
+    return 0;
+  }
+
+  entrada->sessao = (unsigned int)campos[0];
+  entrada->semente = (unsigned int)campos[1];
+  entrada->inicio = (long long)campos[2];
+  entrada->fim = (long long)campos[3];
+  entrada->acoes = (int)acoes;
+  entrada->extras = (int)extras;
+  entrada->bytesExtras = (int)bytesExtras;
+  entrada->deslocamento = campos[7];
+  return 1;
+}
+
+// Função para apagar um arquivo incompleto
+// Só apaga arquivos comuns: a saída pode ter sido um dispositivo (como /dev/full)
+void descartarArquivo(const char *caminho)
+{
+  struct stat informacoes;
+  if (stat(caminho, &informacoes) == 0 && S_ISREG(informacoes.st_mode))
+  {
+    remove(caminho);
+  }
+}
+
+// Função para arquivar várias gravações em um único arquivo compactado
+// Formato: "TSA3", número de partidas, índice (sessão, semente, início, fim, ações, extras,
+// bytes dos extras, deslocamento) e os dados de cada partida: as opções de 0 a 5, três por byte,
+// seguidas da lista das opções 6 e 7 (distância em varint e a opção).
+// As sementes seguem a versão VERSAO_GRAVACAO das gravações
+int arquivarPartidas(const char *caminhoSaida, char *gravacoes[], int totalGravacoes)
+{
+  FILE *saida = fopen(caminhoSaida, "wb");
+  if (saida == NULL)
+  {
+    printf("Erro: Não foi possível criar o arquivo %s!\n", caminhoSaida);
+    return 1;
+  }
+
+  fwrite("TSA3", 1, 4, saida);
+  escreverInteiro(saida, totalGravacoes, 4);
+
+  // Os dados começam logo após o índice
+  unsigned long long deslocamento = 8 + (unsigned long long)totalGravacoes * TAMANHO_INDICE_ARQUIVO;
+
+  for (int i = 0; i < totalGravacoes; i++)
+  {
+    EntradaArquivo entrada;
+    unsigned char *acoes;
+    int quantidade = lerGravacao(gravacoes[i], &entrada, &acoes);
+    if (quantidade < 0)
+    {
+      fclose(saida);
+      descartarArquivo(caminhoSaida); // Não deixa um arquivo incompleto para trás
+      return 1;
+    }
+
+    // O fim da partida é a última modificação da gravação
+    struct stat informacoes;
+    entrada.fim = stat(gravacoes[i], &informacoes) == 0 ? (long long)informacoes.st_mtime : 0;
+
+    // Cada extra ocupa no máximo 5 bytes de distância e 1 da opção
+    unsigned char *principais = malloc(quantidade + 1);
+    unsigned char *extras = malloc(6 * (size_t)quantidade + 1);
+    unsigned char *dados = malloc(quantidade / 3 + 1);
+    if (principais == NULL || extras == NULL || dados == NULL)
+    {
+      printf("Erro: Memória insuficiente para o arquivo!\n");
+      free(principais);
+      free(extras);
+      free(dados);
+      free(acoes);
+      fclose(saida);
+      descartarArquivo(caminhoSaida); // Não deixa um arquivo incompleto para trás
+      return 1;
+    }
+    int totalPrincipais = separarAcoes(acoes, quantidade, principais, extras, &entrada.bytesExtras, &entrada.extras);
+    int bytes = compactarAcoes(principais, totalPrincipais, dados);
+    entrada.acoes = quantidade;
+    entrada.deslocamento = deslocamento;
+
+    // Entrada do índice
+    int falhou = posicionarArquivo(saida, 8 + (unsigned long long)i * TAMANHO_INDICE_ARQUIVO) != 0;
+    escreverEntradaIndice(saida, &entrada);
+
+    // Dados da partida
+    falhou |= posicionarArquivo(saida, deslocamento) != 0;
+    falhou |= (int)fwrite(dados, 1, bytes, saida) != bytes;
+    falhou |= (int)fwrite(extras, 1, entrada.bytesExtras, saida) != entrada.bytesExtras;
+    deslocamento += bytes + entrada.bytesExtras;
+
+    free(principais);
+    free(extras);
+    free(dados);
+    free(acoes);
+
+    // Disco cheio ou erro de escrita: o arquivo não serviria para nada
+    if (falhou || ferror(saida))
+    {
+      printf("Erro: Falha ao escrever o arquivo %s!\n", caminhoSaida);
+      fclose(saida);
+      descartarArquivo(caminhoSaida); // Não deixa um arquivo incompleto para trás
+      return 1;
+    }
+  }
+
+  // O fclose descarrega o que ainda está no buffer, então também pode falhar
+  int falhou = ferror(saida);
+  falhou |= fclose(saida) != 0;
+  if (falhou)
+  {
+    printf("Erro: Falha ao escrever o arquivo %s!\n", caminhoSaida);
+    descartarArquivo(caminhoSaida); // Não deixa um arquivo incompleto para trás
+    return 1;
+  }
+  printf("%d partidas arquivadas em %s (%llu bytes).\n", totalGravacoes, caminhoSaida, deslocamento);
+  return 0;
+}
+
+// Função para abrir um arquivo de partidas e validar o cabeçalho
+// O índice inteiro precisa caber no arquivo, então um total corrompido é recusado aqui
+// Retorna o arquivo aberto (com o total de partidas e o tamanho) ou NULL em caso de erro
+FILE *abrirArquivoPartidas(const char *caminho, int *totalPartidas, unsigned long long *tamanhoArquivo)
+{
+  FILE *arquivo = fopen(caminho, "rb");
+  char assinatura[4];
+  unsigned long long total = 0;
+
+  int valido = arquivo != NULL && medirArquivo(arquivo, tamanhoArquivo) &&
+               fread(assinatura, 1, 4, arquivo) == 4 && memcmp(assinatura, "TSA3", 4) == 0 &&
+               lerInteiro(arquivo, 4, &total) &&
+               8 + total * TAMANHO_INDICE_ARQUIVO <= *tamanhoArquivo;
+  if (!valido)
+  {
+    printf("Erro: %s não é um arquivo de partidas válido!\n", caminho);
+    if (arquivo != NULL)
+    {
+      fclose(arquivo);
+    }
+    return NULL;
+  }
+
+  *totalPartidas = (int)total;
+  return arquivo;
+}
+
+// Função para listar o índice de um arquivo de partidas
+// Com inicio <= fim, mostra só as partidas que começaram nesse intervalo (--buscar)
+int listarArquivo(const char *caminho, long long inicio, long long fim)
+{
+  int totalPartidas;
+  unsigned long long tamanhoArquivo;
+  FILE *arquivo = abrirArquivoPartidas(caminho, &totalPartidas, &tamanhoArquivo);
+  if (arquivo == NULL)
+  {
+    return 1;
+  }
+
+  int filtrar = inicio <= fim;
+  int encontradas = 0;
+
+  printf("Sessão\tSemente\tInício\tFim\tAções\n");
+  for (int i = 0; i < totalPartidas; i++)
+  {
+    EntradaArquivo entrada;
+    if (!lerEntradaIndice(arquivo, tamanhoArquivo, &entrada))
+    {
+      printf("Erro: Entrada %d do índice de %s está corrompida!\n", i + 1, caminho);
+      fclose(arquivo);
+      return 1;
+    }
+    if (filtrar && (entrada.inicio < inicio || entrada.inicio > fim))
+    {
+      continue;
+    }
+    printf("%u\t%u\t%lld\t%lld\t%d\n", entrada.sessao, entrada.semente, entrada.inicio, entrada.fim, entrada.acoes);
+    encontradas++;
+  }
+
+  if (filtrar && encontradas == 0)
+  {
+    printf("Nenhuma partida começou entre %lld e %lld.\n", inicio, fim);
+  }
+
+  fclose(arquivo);
+  return 0;
+}
+
+// Função para extrair uma única partida de um arquivo, no formato de --gravar
+// Procura a sessão no índice e lê somente os dados dessa partida
+int extrairPartida(const char *caminho, unsigned int sessao)
+{
+  int totalPartidas;
+  unsigned long long tamanhoArquivo;
+  FILE *arquivo = abrirArquivoPartidas(caminho, &totalPartidas, &tamanhoArquivo);
+  if (arquivo == NULL)
+  {
+    return 1;
+  }
+
+  EntradaArquivo entrada;
+  int encontrada = 0;
+  for (int i = 0; i < totalPartidas && !encontrada; i++)
+  {
+    if (!lerEntradaIndice(arquivo, tamanhoArquivo, &entrada))
+    {
+      printf("Erro: Entrada %d do índice de %s está corrompida!\n", i + 1, caminho);
+      fclose(arquivo);
+      return 1;
+    }
+    encontrada = entrada.sessao == sessao;
+  }
+  if (!encontrada)
+  {
+    printf("Erro: O arquivo não tem a sessão %u!\n", sessao);
+    fclose(arquivo);
+    return 1;
+  }
+
+  int principais = entrada.acoes - entrada.extras;
+  int bytes = (principais + 2) / 3;
+  unsigned char *dados = malloc(bytes + entrada.bytesExtras + 1);
+  unsigned char *sequencia = malloc(principais + 1);
+  unsigned char *acoes = malloc(entrada.acoes + 1);
+  if (dados == NULL || sequencia == NULL || acoes == NULL)
+  {
+    printf("Erro: Memória insuficiente para a partida!\n");
+    free(dados);
+    free(sequencia);
+    free(acoes);
+    fclose(arquivo);
+    return 1;
+  }
+
+  int lidos = -1;
+  if (posicionarArquivo(arquivo, entrada.deslocamento) == 0)
+  {
+    lidos = (int)fread(dados, 1, bytes + entrada.bytesExtras, arquivo);
+  }
+  if (lidos != bytes + entrada.bytesExtras)
+  {
+    printf("Erro: Arquivo de partidas incompleto!\n");
+    free(dados);
+    free(sequencia);
+    free(acoes);
+    fclose(arquivo);
+    return 1;
+  }
+  descompactarAcoes(dados, principais, sequencia);
+  if (!juntarAcoes(sequencia, dados + bytes, &entrada, acoes))
+  {
+    printf("Erro: Lista de opções extras corrompida na sessão %u!\n", sessao);
+    free(dados);
+    free(sequencia);
+    free(acoes);
+    fclose(arquivo);
+    return 1;
+  }
+
+  printf("v%d %u %u %lld\n", VERSAO_GRAVACAO, entrada.semente, entrada.sessao, entrada.inicio);
+  for (int i = 0; i < entrada.acoes; i++)
+  {
+    printf("%d\n", acoes[i]);
+  }
+
+  free(dados);
+  free(sequencia);
+  free(acoes);
+  fclose(arquivo);
+  return 0;
+}
+
+// Função para gerar as peças de várias sessões e exportar as estatísticas juntas em CSV
+// Cada sessão conta as suas peças separadamente e o total é montado com mesclarEstatisticas
+int exportarSimulacaoEstatisticas(int totalSessoes, long long pecasPorSessao)
+{
+  if (totalSessoes < 1 || pecasPorSessao < 1)
+  {
+    printf("Erro: Informe pelo menos uma sessão e uma peça!\n");
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  EstatisticasPecas total;
+  reiniciarEstatisticas(&total);
+
+  for (int i = 0; i < totalSessoes; i++)
+  {
+    reiniciarEstatisticas(&estatisticas);
+
+    // As peças saem pela fila, como em uma partida (a fila já começa cheia)
+    FilaPecas fila;
+    inicializarFila(&fila, (unsigned int)i + 1);
+    for (long long j = TAMANHO_FILA; j < pecasPorSessao; j++)
+    {
+      jogarPeca(&fila);
+      inserirPeca(&fila);
+    }
+
+    mesclarEstatisticas(&total, &estatisticas);
+  }
+  reiniciarEstatisticas(&estatisticas);
+
+  printf("total,I,seca_I,O,seca_O,T,seca_T,L,seca_L,maior_sequencia,ultimo_qui_quadrado,"
+         "janelas_suspeitas,janelas,secas_suspeitas\n");
+  exportarEstatisticas(&total, stdout);
+  printf("\njanela,I,O,T,L,qui_quadrado,resultado\n");
+  exportarJanelas(&total, stdout);
+  return 0;
+}
+
+// Função para analisar uma sequência longa de peças com a fila segmentada
+// Gera todas as peças de uma vez, joga todas em ordem e repete a rodada para reaproveitar os blocos
+int analisarSequencia(unsigned int semente, long long totalPecas)
+{
+  if (totalPecas < 1)
+  {
+    printf("Erro: Informe pelo menos uma peça!\n");
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  FilaSegmentada fila;
+  inicializarFilaSegmentada(&fila, semente);
+
+  char tipos[] = {'I', 'O', 'T', 'L'};
+  long long contagem[TIPOS_PECA] = {0};
+  long long idEsperado = 0;
+  int falhas = 0;
+
+  for (int rodada = 1; rodada <= 2 && falhas == 0; rodada++)
+  {
+    for (long long i = 0; i < totalPecas; i++)
+    {
+      if (!inserirPecaSegmentada(&fila))
+      {
+        printf("Erro: Memória insuficiente para %lld peças!\n", totalPecas);
+        liberarFilaSegmentada(&fila);
+        return 1;
+      }
+    }
+
+    // As peças precisam sair na mesma ordem em que foram geradas
+    while (fila.tamanho > 0)
+    {
+      Peca peca = jogarPecaSegmentada(&fila);
+      if (peca.id != idEsperado)
+      {
+        printf("Erro: Peça %lld saiu fora de ordem (esperado %lld)!\n", peca.id, idEsperado);
+        falhas++;
+        break;
+      }
+      idEsperado++;
+
+      for (int t = 0; t < TIPOS_PECA; t++)
+      {
+        if (peca.nome == tipos[t])
+        {
+          contagem[t]++;
+        }
+      }
+    }
+
+    printf("Rodada %d: %lld peças, %d blocos alocados até agora\n", rodada, totalPecas, fila.blocosAlocados);
+  }
+
+  if (falhas == 0)
+  {
+    printf("Peças geradas: %lld\n", idEsperado);
+    for (int t = 0; t < TIPOS_PECA; t++)
+    {
+      printf("%c: %lld (%.1f%%)\n", tipos[t], contagem[t], 100.0 * contagem[t] / idEsperado);
+    }
+  }
+
+  liberarFilaSegmentada(&fila);
+  return falhas == 0 ? 0 : 1;
+}
+
+// Função para simular várias sessões em um conjunto e consultar o estado agregado
+int consultarSimulacao(int totalSessoes, int acoesPorSessao)
+{
+  if (totalSessoes < 1)
+  {
+    printf("Erro: Informe pelo menos uma sessão!\n");
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  PoolSessoes pool;
+  if (!criarPoolSessoes(&pool, totalSessoes))
+  {
+    return 1;
+  }
+
+  // Cada sessão tem a sua própria semente
+  for (int i = 0; i < totalSessoes; i++)
+  {
+    obterSessao(&pool, (unsigned int)i + 1);
+  }
+
+  // Opções de 1 a 7, sorteadas por um gerador separado do das peças
+  unsigned int geradorAcoes = prepararSemente(1);
+  for (int passo = 0; passo < acoesPorSessao; passo++)
+  {
+    for (int i = 0; i < totalSessoes; i++)
+    {
+      executarAcao(&pool.sessoes[i], 1 + numeroAleatorio(&geradorAcoes) % 7, NULL);
+    }
+  }
+
+  ConsultaSessoes resultado;
+  clock_t inicio = clock();
+  consultarSessoes(&pool, 1, &resultado);
+  double milissegundos = 1000.0 * (clock() - inicio) / CLOCKS_PER_SEC;
+
+  printf("Sessões ativas: %lld\n", resultado.sessoesAtivas);
+  printf("Pilhas de reserva cheias: %lld\n", resultado.pilhasCheias);
+  printf("Troca múltipla possível: %lld\n", resultado.trocaMultiplaPossivel);
+  printf("Peça da frente: I %lld, O %lld, T %lld, L %lld\n", resultado.frentePorTipo[0],
+         resultado.frentePorTipo[1], resultado.frentePorTipo[2], resultado.frentePorTipo[3]);
+  printf("Consulta concluída em %.2f ms\n", milissegundos);
+
+  liberarPoolSessoes(&pool);
+  return 0;
+}
+
+// Estrutura com o trabalho da thread que joga durante o teste de consulta concorrente
+typedef struct
+{
+  PoolSessoes *pool;   // Conjunto da thread (só ela escreve no resumo)
+  int acoesPorSessao;  // Rodadas de ações sobre todas as sessões
+  atomic_int terminou; // 1 quando a thread termina de jogar
+} TrabalhoConsulta;
+
+// Função executada pela thread que joga: só usa opções de 1 a 7, então nenhuma
+// sessão é encerrada e o número de sessões ativas não pode mudar
+int executarTrabalhoConsulta(void *argumento)
+{
+  TrabalhoConsulta *trabalho = argumento;
+  PoolSessoes *pool = trabalho->pool;
+
+  unsigned int geradorAcoes = prepararSemente(1);
+  for (int passo = 0; passo < trabalho->acoesPorSessao; passo++)
+  {
+    for (int i = 0; i < pool->capacidade; i++)
+    {
+      executarAcao(&pool->sessoes[i], 1 + numeroAleatorio(&geradorAcoes) % 7, NULL);
+    }
+  }
+
+  atomic_store_explicit(&trabalho->terminou, 1, memory_order_release);
+  return 0;
+}
+
+// Função para consultar um conjunto enquanto outra thread joga nas sessões dele
+// Cada consulta precisa ver todas as sessões ativas, uma peça na frente de cada
+// uma e no máximo tantas pilhas cheias quanto sessões
+int consultarConcorrentemente(int totalSessoes, int acoesPorSessao)
+{
+  if (totalSessoes < 1)
+  {
+    printf("Erro: Número de sessões inválido!\n");
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  PoolSessoes pool;
+  if (!criarPoolSessoes(&pool, totalSessoes))
+  {
+    return 1;
+  }
+  for (int i = 0; i < totalSessoes; i++)
+  {
+    obterSessao(&pool, (unsigned int)i + 1);
+  }
+
+  // A criação da thread publica tudo o que foi escrito até aqui
+  TrabalhoConsulta trabalho;
+  trabalho.pool = &pool;
+  trabalho.acoesPorSessao = acoesPorSessao;
+  atomic_init(&trabalho.terminou, 0);
+  thrd_t thread;
+  if (thrd_create(&thread, executarTrabalhoConsulta, &trabalho) != thrd_success)
+  {
+    printf("Erro: Não foi possível criar a thread do teste!\n");
+    liberarPoolSessoes(&pool);
+    return 1;
+  }
+
+  long long consultas = 0;
+  long long falhas = 0;
+  int terminou;
+  do
+  {
+    // Lido antes da consulta: a última consulta já vê o estado final
+    terminou = atomic_load_explicit(&trabalho.terminou, memory_order_acquire);
+
+    ConsultaSessoes resultado;
+    consultarSessoes(&pool, 1, &resultado);
+    long long frentes = resultado.frentePorTipo[0] + resultado.frentePorTipo[1] +
+                        resultado.frentePorTipo[2] + resultado.frentePorTipo[3];
+    if (resultado.sessoesAtivas != totalSessoes || frentes != totalSessoes ||
+        resultado.pilhasCheias > totalSessoes || resultado.trocaMultiplaPossivel > resultado.pilhasCheias)
+    {
+      if (falhas < 10)
+      {
+        printf("Erro: Consulta %lld inconsistente (ativas %lld, frentes %lld, cheias %lld, trocas %lld)\n",
+               consultas, resultado.sessoesAtivas, frentes, resultado.pilhasCheias,
+               resultado.trocaMultiplaPossivel);
+      }
+      falhas++;
+    }
+    consultas++;
+  } while (!terminou);
+
+  thrd_join(thread, NULL);
+  liberarPoolSessoes(&pool);
+
+  if (falhas > 0)
+  {
+    printf("Erro: %lld de %lld consultas inconsistentes!\n", falhas, consultas);
+    return 1;
+  }
+  printf("%lld consultas consistentes durante %d rodadas de ações em %d sessões.\n", consultas,
+         acoesPorSessao, totalSessoes);
+  return 0;
+}
+
+// Estrutura com o trabalho de uma thread do teste de falso compartilhamento
+typedef struct
+{
+  CabecalhoSessao *copia; // Onde a thread publica o cabeçalho após cada ação
+  long long passos;       // Ações a executar
+  unsigned int semente;   // Semente das peças e das ações da thread
+} TrabalhoCompartilhamento;
+
+// Função executada por cada thread do teste: conduz uma sessão própria e, após
+// cada ação, copia o cabeçalho dela para a posição reservada à thread
+int executarTrabalhoCompartilhamento(void *argumento)
+{
+  TrabalhoCompartilhamento *trabalho = argumento;
+  Sessao sessao;
+  inicializarSessao(&sessao, trabalho->semente);
+
+  unsigned int geradorAcoes = prepararSemente(trabalho->semente + 1);
+  for (long long passo = 0; passo < trabalho->passos; passo++)
+  {
+    executarAcao(&sessao, 1 + numeroAleatorio(&geradorAcoes) % 5, NULL);
+    *trabalho->copia = sessao.cabecalho;
+
+    // Nada é desfeito aqui, então o histórico não precisa ser guardado
+    limparHistorico(&sessao.historico);
+  }
+
+  encerrarSessao(&sessao);
+  return 0;
+}
+
+// Função para executar o teste com as duas copias separadas por "espacamento" bytes
+// Retorna o tempo em milissegundos, ou -1 se as threads não puderem ser criadas
+double medirCompartilhamento(unsigned char *copias, size_t espacamento, long long passos)
+{
+  TrabalhoCompartilhamento trabalhos[2];
+  thrd_t threads[2];
+  struct timespec inicio, fim;
+  int criadas = 0;
+
+  timespec_get(&inicio, TIME_UTC);
+  for (int i = 0; i < 2; i++)
+  {
+    trabalhos[i].copia = (CabecalhoSessao *)(copias + i * espacamento);
+    trabalhos[i].passos = passos;
+    trabalhos[i].semente = (unsigned int)i + 1;
+    if (thrd_create(&threads[i], executarTrabalhoCompartilhamento, &trabalhos[i]) != thrd_success)
+    {
+      break;
+    }
+    criadas++;
+  }
+  for (int i = 0; i < criadas; i++)
+  {
+    thrd_join(threads[i], NULL);
+  }
+  timespec_get(&fim, TIME_UTC);
+
+  if (criadas < 2)
+  {
+    return -1;
+  }
+  return (fim.tv_sec - inicio.tv_sec) * 1000.0 + (fim.tv_nsec - inicio.tv_nsec) / 1e6;
+}
+
+// Função para medir o custo do falso compartilhamento entre duas threads
+// Cada thread conduz a sua sessão e publica o cabeçalho dela; primeiro as duas
+// copias ficam lado a lado (mesma linha de cache), depois em linhas separadas,
+// como os cabeçalhos das sessões de um conjunto. A diferença só aparece em uma
+// máquina com mais de um núcleo livre.
+int medirFalsoCompartilhamento(long long passos)
+{
+  if (passos < 1)
+  {
+    printf("Erro: Número de passos inválido!\n");
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  unsigned char *copias = alocarAlinhado(2 * TAMANHO_LINHA_CACHE);
+  if (copias == NULL)
+  {
+    printf("Erro: Memória insuficiente para o teste!\n");
+    return 1;
+  }
+
+  double juntas = medirCompartilhamento(copias, sizeof(CabecalhoSessao), passos);
+  double separadas = medirCompartilhamento(copias, TAMANHO_LINHA_CACHE, passos);
+  liberarAlinhado(copias);
+
+  if (juntas < 0 || separadas < 0)
+  {
+    printf("Erro: Não foi possível criar as threads do teste!\n");
+    return 1;
+  }
+
+  printf("Cabeçalhos na mesma linha de cache: %.2f ms\n", juntas);
+  printf("Cabeçalhos em linhas separadas (%d bytes): %.2f ms\n", TAMANHO_LINHA_CACHE, separadas);
+  printf("Razão: %.2fx\n", separadas > 0 ? juntas / separadas : 0.0);
+  return 0;
+}
+
+// Função para repetir uma partida gravada, exibindo o hash do estado a cada passo
+// Formato da gravação: a semente seguida das opções escolhidas, uma por linha
+int repetirPartida(const char *caminho)
+{
+  FILE *arquivo = fopen(caminho, "r");
+  if (arquivo == NULL)
+  {
+    printf("Erro: Não foi possível abrir a gravação %s!\n", caminho);
+    return 1;
+  }
+
+  unsigned int semente, sessaoGravada;
+  long long inicio;
+  int cabecalho = lerCabecalhoGravacao(arquivo, &semente, &sessaoGravada, &inicio);
+  if (cabecalho != 1)
+  {
+    exibirErroCabecalho(caminho, cabecalho);
+    fclose(arquivo);
+    return 1;
+  }
+
+  exibirMensagens = 0;
+  reiniciarIds();
+
+  Sessao sessao;
+  inicializarSessao(&sessao, semente);
+
+  // Cada linha: passo, opção aplicada (-1 no estado inicial) e hash do estado
+  int passo = 0;
+  int opcao = -1;
+  printf("%d %d %016llx\n", passo, opcao, hashEstado(&sessao));
+
+  while (sessao.ativa && fscanf(arquivo, "%d", &opcao) == 1)
+  {
+    executarAcao(&sessao, opcao, NULL);
+    passo++;
+    printf("%d %d %016llx\n", passo, opcao, hashEstado(&sessao));
+  }
+
+  encerrarSessao(&sessao);
+  fclose(arquivo);
+  return 0;
+}
+
+// Função para comparar as saídas de --repetir de duas versões do programa
+// Informa o primeiro passo em que os estados divergem
+int compararRepeticoes(const char *caminhoA, const char *caminhoB)
+{
+  FILE *arquivoA = fopen(caminhoA, "r");
+  FILE *arquivoB = fopen(caminhoB, "r");
+  if (arquivoA == NULL || arquivoB == NULL)
+  {
+    printf("Erro: Não foi possível abrir as repetições para comparar!\n");
+    if (arquivoA != NULL)
+    {
+      fclose(arquivoA);
+    }
+    if (arquivoB != NULL)
+    {
+      fclose(arquivoB);
+    }
+    return 1;
+  }
+
+  int passoA, passoB, opcaoA, opcaoB;
+  unsigned long long hashA, hashB;
+  int divergente = 0;
+  int passos = 0;
+
+  while (1)
+  {
+    int lidoA = fscanf(arquivoA, "%d %d %llx", &passoA, &opcaoA, &hashA) == 3;
+    int lidoB = fscanf(arquivoB, "%d %d %llx", &passoB, &opcaoB, &hashB) == 3;
+
+    if (!lidoA && !lidoB)
+    {
+      break;
+    }
+
+    if (lidoA != lidoB)
+    {
+      printf("Divergência: uma das repetições termina no passo %d!\n", passos);
+      divergente = 1;
       break;
-    default:
-      printf("Opção inválida! Tente novamente.\n");
+    }
+
+    if (opcaoA != opcaoB || hashA != hashB)
+    {
+      printf("Divergência no passo %d (opção %d): %016llx != %016llx\n", passoA, opcaoA, hashA, hashB);
+      divergente = 1;
       break;
     }
 
-    // Pausa para melhor visualização
-    if (opcao != 0)
+    passos++;
+  }
+
+  if (!divergente)
+  {
+    printf("Repetições idênticas em %d passos.\n", passos);
+  }
+
+  fclose(arquivoA);
+  fclose(arquivoB);
+  return divergente;
+}
+
+// Função para exibir as formas de chamar o programa
+void exibirUso(const char *programa)
+{
+  printf("Uso: %s [--tui] [--gravar arquivo] [--sessao id]\n", programa);
+  printf("     %s --repetir gravacao\n", programa);
+  printf("     %s --comparar repeticaoA repeticaoB\n", programa);
+  printf("     %s --aleatorio semente acoes\n", programa);
+  printf("     %s --arquivar arquivo gravacao...\n", programa);
+  printf("     %s --listar arquivo\n", programa);
+  printf("     %s --buscar arquivo inicio fim\n", programa);
+  printf("     %s --extrair arquivo sessao\n", programa);
+  printf("     %s --consultar sessoes acoes\n", programa);
+  printf("     %s --consultar-concorrente sessoes acoes\n", programa);
+  printf("     %s --analise semente pecas\n", programa);
+  printf("     %s --estatisticas sessoes pecas\n", programa);
+  printf("     %s --versus semente jogadores partidas\n", programa);
+  printf("     %s --falso-compartilhamento passos\n", programa);
+}
+
+int main(int argc, char *argv[])
+{
+  // Modos de verificação: repetir uma gravação ou comparar duas repetições
+  if (argc == 3 && strcmp(argv[1], "--repetir") == 0)
+  {
+    return repetirPartida(argv[2]);
+  }
+  if (argc == 4 && strcmp(argv[1], "--comparar") == 0)
+  {
+    return compararRepeticoes(argv[2], argv[3]);
+  }
+  if (argc == 4 && strcmp(argv[1], "--aleatorio") == 0)
+  {
+    return testarAleatoriamente((unsigned int)strtoul(argv[2], NULL, 10), atoll(argv[3]));
+  }
+  if (argc >= 4 && strcmp(argv[1], "--arquivar") == 0)
+  {
+    return arquivarPartidas(argv[2], &argv[3], argc - 3);
+  }
+  if (argc == 3 && strcmp(argv[1], "--listar") == 0)
+  {
+    return listarArquivo(argv[2], 1, 0);
+  }
+  if (argc == 5 && strcmp(argv[1], "--buscar") == 0)
+  {
+    return listarArquivo(argv[2], atoll(argv[3]), atoll(argv[4]));
+  }
+  if (argc == 4 && strcmp(argv[1], "--extrair") == 0)
+  {
+    return extrairPartida(argv[2], (unsigned int)strtoul(argv[3], NULL, 10));
+  }
+  if (argc == 4 && strcmp(argv[1], "--consultar") == 0)
+  {
+    return consultarSimulacao(atoi(argv[2]), atoi(argv[3]));
+  }
+  if (argc == 4 && strcmp(argv[1], "--consultar-concorrente") == 0)
+  {
+    return consultarConcorrentemente(atoi(argv[2]), atoi(argv[3]));
+  }
+  if (argc == 4 && strcmp(argv[1], "--analise") == 0)
+  {
+    return analisarSequencia((unsigned int)strtoul(argv[2], NULL, 10), atoll(argv[3]));
+  }
+  if (argc == 4 && strcmp(argv[1], "--estatisticas") == 0)
+  {
+    return exportarSimulacaoEstatisticas(atoi(argv[2]), atoll(argv[3]));
+  }
+  if (argc == 5 && strcmp(argv[1], "--versus") == 0)
+  {
+    return simularPartidas((unsigned int)strtoul(argv[2], NULL, 10), atoi(argv[3]), atoi(argv[4]));
+  }
+  if (argc == 3 && strcmp(argv[1], "--falso-compartilhamento") == 0)
+  {
+    return medirFalsoCompartilhamento(atoll(argv[2]));
+  }
+
+  // Opções do modo interativo: tela no terminal (--tui), gravação (--gravar arquivo)
+  // e identificador da sessão gravada (--sessao id; sem ele, é a semente)
+  // Qualquer outro argumento (inclusive um modo com a quantidade errada de parâmetros) exibe o uso
+  const char *caminhoGravacao = NULL;
+  const char *sessaoInformada = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--tui") == 0)
+    {
+      modoTela = 1;
+    }
+    else if (strcmp(argv[i], "--sessao") == 0 && i + 1 < argc)
+    {
+      sessaoInformada = argv[++i];
+    }
+    else if (strcmp(argv[i], "--gravar") == 0 && i + 1 < argc && caminhoGravacao == NULL)
+    {
+      caminhoGravacao = argv[++i];
+    }
+    else
+    {
+      printf("Erro: Argumento inválido: %s\n", argv[i]);
+      exibirUso(argv[0]);
+      return 1;
+    }
+  }
+
+  FILE *gravacao = NULL;
+  if (caminhoGravacao != NULL)
+  {
+    gravacao = fopen(caminhoGravacao, "w");
+    if (gravacao == NULL)
+    {
+      printf("Erro: Não foi possível criar a gravação %s!\n", caminhoGravacao);
+      return 1;
+    }
+  }
+
+  // Console em UTF-8 no Windows, sem abrir um processo do chcp
+#ifdef _WIN32
+  SetConsoleOutputCP(CP_UTF8);
+
+  // O modo --tui usa sequências ANSI, que o console do Windows só interpreta se ativadas
+  if (modoTela)
+  {
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD modo;
+    if (console == INVALID_HANDLE_VALUE || !GetConsoleMode(console, &modo) ||
+        !SetConsoleMode(console, modo | ENABLE_VIRTUAL_TERMINAL_PROCESSING))
+    {
+      printf("Erro: O console não aceita sequências ANSI; o modo --tui foi desativado.\n");
+      modoTela = 0;
+    }
+  }
+#endif
+  setlocale(LC_ALL, "C.UTF-8");
+
+  // Inicializa o gerador de números aleatórios
+  time_t inicio = time(NULL);
+  unsigned int semente = (unsigned int)inicio;
+  if (gravacao != NULL)
+  {
+    unsigned int idSessao = sessaoInformada != NULL ? (unsigned int)strtoul(sessaoInformada, NULL, 10) : semente;
+    fprintf(gravacao, "v%d %u %u %lld\n", VERSAO_GRAVACAO, semente, idSessao, (long long)inicio);
+  }
+
+  Sessao sessao;
+  Tela tela;
+  int opcao;
+
+  // Inicializa as estruturas
+  inicializarSessao(&sessao, semente);
+
+  if (modoTela)
+  {
+    iniciarTela(&tela);
+  }
+  else
+  {
+    printf("=== TETRIS STACK - DESAFIO MESTRE ===\n");
+    printf("Gerenciador avançado de peças com trocas entre fila e pilha\n");
+  }
+
+  do
+  {
+    if (modoTela)
+    {
+      // Redesenha somente o que mudou desde o último quadro
+      desenharEstado(&tela, &sessao);
+      atualizarTela(&tela, LINHA_ENTRADA_TELA);
+    }
+    else
+    {
+      // Exibe o estado atual do jogo e o menu
+      exibirEstado(&sessao.fila, &sessao.pilha);
+      exibirMenu();
+    }
+
+    // Lê a opção do usuário: só o fim da entrada encerra o jogo
+    int lidos = scanf("%d", &opcao);
+    if (lidos == EOF)
+    {
+      opcao = 0;
+    }
+    else if (lidos != 1)
+    {
+      // Entrada que não é número: descarta o resto da linha (menos o \n) e trata como opção inválida
+      scanf("%*[^\n]");
+      opcao = -1;
+    }
+
+    // A opção 8 e as inválidas não mudam o estado, então ficam fora da gravação
+    if (gravacao != NULL && opcao >= 0 && opcao < ACOES_GRAVAVEIS)
+    {
+      fprintf(gravacao, "%d\n", opcao);
+    }
+
+    executarAcao(&sessao, opcao, NULL);
+
+    // Pausa para melhor visualização (a tela do terminal não rola, então não precisa)
+    if (sessao.ativa && !modoTela)
     {
       printf("\nPressione Enter para continuar...");
       getchar(); // Consome o \n deixado pelo scanf
       getchar(); // Aguarda o Enter do usuário
     }
 
-  } while (opcao != 0);
+  } while (sessao.ativa);
+
+  if (modoTela)
+  {
+    // Devolve o cursor para baixo do quadro
+    printf("\033[%d;1H", LINHAS_TELA + 1);
+  }
 
+  encerrarSessao(&sessao);
+  if (gravacao != NULL)
+  {
+    fclose(gravacao);
+  }
   return 0;
-}
\ No newline at end of file
+}